@@ -0,0 +1,362 @@
+#include "game.h"
+#include "movegen.h"
+#include "trace.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Repeatable microbenchmarks of the engine's hot paths. Every benchmark runs on fixed seeds and positions, calibrates
+// its batch to BENCH_BATCH_NS, and reports the best and median of BENCH_SAMPLES batches as JSON.
+#define BENCH_SEED 0xC0FFEE
+#define BENCH_SAMPLES 9
+#define BENCH_BATCH_NS 20000000ULL
+
+// With -Wl,--wrap the linker routes every allocation of the engine through these counters
+static _Atomic uint64_t bench_allocs = 0;
+
+#ifdef BENCH_COUNT_ALLOCS
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t cnt, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_aligned_alloc(size_t align, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  atomic_fetch_add_explicit(&bench_allocs, 1, memory_order_relaxed);
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t cnt, size_t size) {
+  atomic_fetch_add_explicit(&bench_allocs, 1, memory_order_relaxed);
+  return __real_calloc(cnt, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  atomic_fetch_add_explicit(&bench_allocs, 1, memory_order_relaxed);
+  return __real_realloc(ptr, size);
+}
+
+void *__wrap_aligned_alloc(size_t align, size_t size) {
+  atomic_fetch_add_explicit(&bench_allocs, 1, memory_order_relaxed);
+  return __real_aligned_alloc(align, size);
+}
+#endif
+
+// Results feed into this so the compiler cannot drop the work being timed
+static uint64_t volatile bench_sink = 0;
+
+typedef struct {
+  GameState *state;
+  TetrominoWell *well;
+  TetrominoWell *full;
+  // A plain copy, wells hand their pool back out on reset
+  Tetromino t;
+  MoveGen *gen;
+  uint64_t rng;
+} BenchCtx;
+
+typedef struct {
+  char const *name;
+  // What one op is, printed alongside the numbers
+  char const *op;
+  void (*run)(BenchCtx *const ctx, uint64_t const iters);
+  // Largest batch the benchmark takes, 0 for no limit
+  uint64_t max_iters;
+  // Optional, runs untimed before every batch, false skips the benchmark
+  bool (*prepare)(BenchCtx *const ctx);
+} Bench;
+
+static uint64_t _Bench_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t _Bench_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static uint64_t _Bench_rand(BenchCtx *const ctx) {
+  uint64_t x = ctx->rng;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  ctx->rng = x;
+  return x;
+}
+
+// A ragged stack over the bottom half, the same for every run
+static void _Bench_stack(TetrominoWell *const w) {
+  uint64_t rng = BENCH_SEED;
+  for (size_t row = w->rows / 2; row < w->rows; row++) {
+    for (size_t col = 0; col < w->cols; col++) {
+      rng ^= rng << 13;
+      rng ^= rng >> 7;
+      rng ^= rng << 17;
+      if (rng % 4 != 0 && !TetrominoWell_occupied(w, row, col)) {
+        TetrominoWell_fill(w, row, col);
+      }
+    }
+  }
+}
+
+static void _Bench_tetromino_init(BenchCtx *const ctx, uint64_t const iters) {
+  for (uint64_t i = 0; i < iters; i++) {
+    Tetromino *t = Tetromino_init(ctx->well->pool, (ETetrominoShape)(i % TETROMINO_SHAPE_CNT), 0, 3);
+    bench_sink += t->bound_size;
+    Tetromino_free(ctx->well->pool, t);
+  }
+}
+
+static void _Bench_coords(BenchCtx *const ctx, uint64_t const iters) {
+  for (uint64_t i = 0; i < iters; i++) {
+    ctx->t.col0 = i & 3;
+    bench_sink += TetrominoWell_coords(&ctx->t).coords[7];
+  }
+}
+
+static void _Bench_rotate(BenchCtx *const ctx, uint64_t const iters) {
+  for (uint64_t i = 0; i < iters; i++) {
+    Tetromino_rotate(&ctx->t, 90);
+  }
+  bench_sink += ctx->t.deg;
+}
+
+static void _Bench_collision(BenchCtx *const ctx, uint64_t const iters) {
+  for (uint64_t i = 0; i < iters; i++) {
+    ctx->t.row0 = (i >> 2) % (ctx->well->rows - 3);
+    bench_sink += TetrominoWell_collision(ctx->well, &ctx->t, 1, (size_t)(i & 3) - 1);
+  }
+}
+
+static void _Bench_full_row_mask(BenchCtx *const ctx, uint64_t const iters) {
+  for (uint64_t i = 0; i < iters; i++) {
+    bench_sink += TetrominoWell_full_row_mask(ctx->full);
+  }
+}
+
+static void _Bench_well_copy(BenchCtx *const ctx, uint64_t const iters) {
+  for (uint64_t i = 0; i < iters; i++) {
+    TetrominoWell_copy(ctx->well, ctx->full);
+  }
+  bench_sink += ctx->well->hash;
+}
+
+static void _Bench_line_clear(BenchCtx *const ctx, uint64_t const iters) {
+  for (uint64_t i = 0; i < iters; i++) {
+    TetrominoWell_copy(ctx->well, ctx->full);
+    bench_sink += TetrominoWell_clear_full_rows(ctx->well);
+  }
+}
+
+static void _Bench_hard_drop(BenchCtx *const ctx, uint64_t const iters) {
+  GameState *const state = ctx->state;
+  static const InputMask shifts[] = {INPUT_NONE, INPUT_MOVE_LEFT, INPUT_MOVE_RIGHT, INPUT_ROTATE_RIGHT};
+
+  for (uint64_t i = 0; i < iters; i++) {
+    // Spawns the next piece, then drops it
+    Game_step(state, shifts[i & 3]);
+    if (Game_step(state, INPUT_HARD_DROP) == GAME_STATUS_OVER) {
+      GameState_reset(state, BENCH_SEED + i);
+    }
+  }
+  bench_sink += state->lines;
+}
+
+static void _Bench_movegen(BenchCtx *const ctx, uint64_t const iters) {
+  for (uint64_t i = 0; i < iters; i++) {
+    Tetromino *t = Tetromino_init(ctx->well->pool, (ETetrominoShape)(i % TETROMINO_SHAPE_CNT), 0, 3);
+    bench_sink += MoveGen_placements(ctx->gen, ctx->well, t);
+    Tetromino_free(ctx->well->pool, t);
+  }
+}
+
+static void _Bench_game(BenchCtx *const ctx, uint64_t const iters) {
+  GameState *const state = ctx->state;
+
+  for (uint64_t i = 0; i < iters; i++) {
+    GameState_reset(state, BENCH_SEED + i);
+    ctx->rng = BENCH_SEED + i;
+
+    // Random taps, a tick in four, until the stack tops out
+    while (Game_step(state, _Bench_rand(ctx) % 4 == 0 ? (InputMask)(_Bench_rand(ctx) & 0x3F) : INPUT_NONE) ==
+           GAME_STATUS_PLAYING) {
+      continue;
+    }
+    bench_sink += state->tick;
+  }
+}
+
+// Every batch gets a fresh trace and fits in its buffer, so no event takes the drop path while timed
+static bool _Bench_trace_prepare(BenchCtx *const ctx) {
+  (void)ctx;
+  Trace_stop();
+  return Trace_start("/dev/null");
+}
+
+static void _Bench_trace_event(BenchCtx *const ctx, uint64_t const iters) {
+  (void)ctx;
+  for (uint64_t i = 0; i < iters; i++) {
+    Trace_event(TRACE_PHASE_INSTANT, "bench", (int64_t)i);
+  }
+}
+
+static const Bench BENCHES[] = {
+    {"tetromino_init", "init and free from the pool", _Bench_tetromino_init, 0, NULL},
+    {"well_coords", "TetrominoWell_coords", _Bench_coords, 0, NULL},
+    {"rotate", "Tetromino_rotate by 90", _Bench_rotate, 0, NULL},
+    {"collision", "TetrominoWell_collision on a half full well", _Bench_collision, 0, NULL},
+    {"full_row_mask", "TetrominoWell_full_row_mask", _Bench_full_row_mask, 0, NULL},
+    {"well_copy", "TetrominoWell_copy", _Bench_well_copy, 0, NULL},
+    {"line_clear", "TetrominoWell_copy then clearing 4 rows", _Bench_line_clear, 0, NULL},
+    {"hard_drop", "spawn and hard drop one piece", _Bench_hard_drop, 0, NULL},
+    {"movegen", "MoveGen_placements on a half full well", _Bench_movegen, 0, NULL},
+    {"game", "full game of random inputs to top out", _Bench_game, 0, NULL},
+    {"trace_event", "Trace_event into a running trace", _Bench_trace_event, TRACE_CAP, _Bench_trace_prepare},
+};
+
+static void _BenchCtx_reset(BenchCtx *const ctx) {
+  GameState_reset(ctx->state, BENCH_SEED);
+  TetrominoWell_reset(ctx->well);
+  _Bench_stack(ctx->well);
+  ctx->t.row0 = 0;
+  ctx->t.col0 = 3;
+  ctx->rng = BENCH_SEED;
+}
+
+static int _Bench_cmp(void const *a, void const *b) {
+  double const x = *(double const *)a, y = *(double const *)b;
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+  char const *filter = NULL;
+  char const *out_path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      out_path = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--filter substring] [--out results.json]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  FILE *const out = out_path != NULL ? fopen(out_path, "w") : stdout;
+  if (out == NULL) {
+    perror(out_path);
+    return 1;
+  }
+
+  BenchCtx ctx = {0};
+  ctx.state = GameState_init(BENCH_SEED);
+  ctx.well = TetrominoWell_init(WELL_ROWS, WELL_COLS);
+  ctx.full = TetrominoWell_init(WELL_ROWS, WELL_COLS);
+  Tetromino *const t = Tetromino_init(ctx.well->pool, TETROMINO_SHAPE_T, 0, 3);
+  ctx.t = *t;
+  Tetromino_free(ctx.well->pool, t);
+  ctx.gen = calloc(1, sizeof(MoveGen));
+
+  // Four full rows under the ragged stack, ready to clear
+  _Bench_stack(ctx.full);
+  for (size_t row = WELL_ROWS - 4; row < WELL_ROWS; row++) {
+    for (size_t col = 0; col < WELL_COLS; col++) {
+      if (!TetrominoWell_occupied(ctx.full, row, col)) {
+        TetrominoWell_fill(ctx.full, row, col);
+      }
+    }
+  }
+
+  fprintf(out, "{\n  \"seed\": %u,\n  \"samples\": %d,\n  \"cycles\": %s,\n  \"allocs\": %s,\n  \"benchmarks\": [",
+          BENCH_SEED, BENCH_SAMPLES, _Bench_cycles() != 0 ? "true" : "false",
+#ifdef BENCH_COUNT_ALLOCS
+          "true"
+#else
+          "false"
+#endif
+  );
+
+  bool first = true;
+  for (size_t b = 0; b < sizeof(BENCHES) / sizeof(BENCHES[0]); b++) {
+    Bench const *const bench = &BENCHES[b];
+    if (filter != NULL && strstr(bench->name, filter) == NULL) {
+      continue;
+    }
+
+    uint64_t const max_iters = bench->max_iters != 0 ? bench->max_iters : (1ULL << 32);
+    if (bench->prepare != NULL && !bench->prepare(&ctx)) {
+      fprintf(stderr, "%s: skipped, not supported by this build\n", bench->name);
+      continue;
+    }
+
+    // Doubles the batch until it runs long enough to time reliably
+    uint64_t iters = 1;
+    for (;;) {
+      _BenchCtx_reset(&ctx);
+      if (bench->prepare != NULL) {
+        bench->prepare(&ctx);
+      }
+      uint64_t const start = _Bench_ns();
+      bench->run(&ctx, iters);
+      if (_Bench_ns() - start >= BENCH_BATCH_NS / 4 || iters >= max_iters) {
+        break;
+      }
+      iters *= 2;
+    }
+    iters = iters * 4 < max_iters ? iters * 4 : max_iters;
+
+    double ns[BENCH_SAMPLES], cycles[BENCH_SAMPLES];
+    uint64_t allocs = 0, dropped = 0;
+    for (size_t s = 0; s < BENCH_SAMPLES; s++) {
+      _BenchCtx_reset(&ctx);
+      if (bench->prepare != NULL) {
+        bench->prepare(&ctx);
+      }
+      uint64_t const dropped0 = Trace_dropped();
+      uint64_t const allocs0 = atomic_load(&bench_allocs);
+      uint64_t const c0 = _Bench_cycles();
+      uint64_t const t0 = _Bench_ns();
+      bench->run(&ctx, iters);
+      uint64_t const t1 = _Bench_ns();
+      uint64_t const c1 = _Bench_cycles();
+      allocs += atomic_load(&bench_allocs) - allocs0;
+      dropped += Trace_dropped() - dropped0;
+
+      ns[s] = (double)(t1 - t0) / (double)iters;
+      cycles[s] = (double)(c1 - c0) / (double)iters;
+    }
+    qsort(ns, BENCH_SAMPLES, sizeof(double), _Bench_cmp);
+    qsort(cycles, BENCH_SAMPLES, sizeof(double), _Bench_cmp);
+
+    fprintf(out,
+            "%s\n    {\"name\": \"%s\", \"op\": \"%s\", \"iters\": %llu, \"ns_min\": %.3f, \"ns_median\": %.3f, "
+            "\"cycles_min\": %.1f, \"cycles_median\": %.1f, \"allocs_per_op\": %.4f, \"dropped_events\": %llu}",
+            first ? "" : ",", bench->name, bench->op, (unsigned long long)iters, ns[0], ns[BENCH_SAMPLES / 2],
+            cycles[0], cycles[BENCH_SAMPLES / 2], (double)allocs / (double)(iters * BENCH_SAMPLES),
+            (unsigned long long)dropped);
+    first = false;
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  Trace_stop();
+  free(ctx.gen);
+  TetrominoWell_free(ctx.full);
+  TetrominoWell_free(ctx.well);
+  GameState_free(ctx.state);
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  return 0;
+}
@@ -0,0 +1,247 @@
+#include "atlas.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Just enough JSON to walk an Aseprite export: objects, arrays, strings and non-negative integers, anything else is
+// skipped over. Any syntax error sticks in ok and every later read fails.
+typedef struct {
+  char const *p, *end;
+  bool ok;
+} _Json;
+
+static void _Json_ws(_Json *const j) {
+  while (j->p < j->end && (*j->p == ' ' || *j->p == '\t' || *j->p == '\n' || *j->p == '\r')) {
+    j->p++;
+  }
+}
+
+static bool _Json_peek(_Json *const j, char const c) {
+  _Json_ws(j);
+  return j->ok && j->p < j->end && *j->p == c;
+}
+
+static bool _Json_eat(_Json *const j, char const c) {
+  if (!_Json_peek(j, c)) {
+    return false;
+  }
+  j->p++;
+  return true;
+}
+
+static void _Json_expect(_Json *const j, char const c) { j->ok = _Json_eat(j, c); }
+
+// Copies the string, truncated to cap - 1 bytes. Escapes are kept as written, names in exports don't need them.
+static void _Json_string(_Json *const j, char *const out, size_t const cap) {
+  size_t len = 0;
+  _Json_expect(j, '"');
+
+  while (j->ok && j->p < j->end && *j->p != '"') {
+    if (*j->p == '\\' && j->p + 1 < j->end) {
+      j->p++;
+    }
+    if (out != NULL && len + 1 < cap) {
+      out[len++] = *j->p;
+    }
+    j->p++;
+  }
+
+  if (out != NULL && cap > 0) {
+    out[len] = '\0';
+  }
+  _Json_expect(j, '"');
+}
+
+static long _Json_int(_Json *const j) {
+  _Json_ws(j);
+
+  long value = 0;
+  char const *const start = j->p;
+  while (j->p < j->end && *j->p >= '0' && *j->p <= '9' && value < 0xFFFFFF) {
+    value = value * 10 + (*j->p++ - '0');
+  }
+
+  j->ok = j->ok && j->p != start;
+  return value;
+}
+
+static void _Json_skip(_Json *const j) {
+  _Json_ws(j);
+  if (!j->ok || j->p >= j->end) {
+    j->ok = false;
+    return;
+  }
+
+  char const c = *j->p;
+  if (c == '"') {
+    _Json_string(j, NULL, 0);
+  } else if (c == '{' || c == '[') {
+    char const close = c == '{' ? '}' : ']';
+    j->p++;
+    while (j->ok && !_Json_eat(j, close)) {
+      if (c == '{') {
+        _Json_string(j, NULL, 0);
+        _Json_expect(j, ':');
+      }
+      _Json_skip(j);
+      if (!_Json_peek(j, close)) {
+        _Json_expect(j, ',');
+      }
+    }
+  } else {
+    // Numbers and literals run up to the next delimiter
+    char const *const start = j->p;
+    while (j->p < j->end && !strchr(",}] \t\r\n", *j->p)) {
+      j->p++;
+    }
+    j->ok = j->p != start;
+  }
+}
+
+// Walks the members of an object, stopping at each key for the caller to read or skip the value
+static bool _Json_member(_Json *const j, char *const key, size_t const cap, bool *const first) {
+  if (*first) {
+    _Json_expect(j, '{');
+    *first = false;
+  } else if (!_Json_peek(j, '}')) {
+    _Json_expect(j, ',');
+  }
+
+  if (!j->ok || _Json_eat(j, '}')) {
+    return false;
+  }
+
+  _Json_string(j, key, cap);
+  _Json_expect(j, ':');
+  return j->ok;
+}
+
+static uint16_t _Json_u16(_Json *const j) {
+  long const value = _Json_int(j);
+  j->ok = j->ok && value <= UINT16_MAX;
+  return (uint16_t)value;
+}
+
+// Reads an {"x", "y", "w", "h"} object, any of the four may be missing
+static void _Json_rect(_Json *const j, uint16_t *const x, uint16_t *const y, uint16_t *const w, uint16_t *const h) {
+  char key[8];
+  bool first = true;
+
+  while (_Json_member(j, key, sizeof(key), &first)) {
+    if (strcmp(key, "x") == 0 && x != NULL) {
+      *x = _Json_u16(j);
+    } else if (strcmp(key, "y") == 0 && y != NULL) {
+      *y = _Json_u16(j);
+    } else if (strcmp(key, "w") == 0) {
+      *w = _Json_u16(j);
+    } else if (strcmp(key, "h") == 0) {
+      *h = _Json_u16(j);
+    } else {
+      _Json_skip(j);
+    }
+  }
+}
+
+static void _Atlas_frame(Atlas *const atlas, _Json *const j) {
+  if (atlas->cnt == ATLAS_MAX_FRAMES) {
+    j->ok = false;
+    return;
+  }
+
+  AtlasFrame *const f = &atlas->frames[atlas->cnt++];
+  char key[32];
+  bool first = true;
+
+  while (_Json_member(j, key, sizeof(key), &first)) {
+    if (strcmp(key, "frame") == 0) {
+      _Json_rect(j, &f->x, &f->y, &f->w, &f->h);
+    } else if (strcmp(key, "sourceSize") == 0) {
+      _Json_rect(j, NULL, NULL, &f->source_w, &f->source_h);
+    } else if (strcmp(key, "duration") == 0) {
+      f->duration_ms = _Json_u16(j);
+    } else {
+      _Json_skip(j);
+    }
+  }
+}
+
+/**
+ * Reads the frame table out of an Aseprite sprite sheet JSON, either the hash or the array frame layout.
+ *
+ * @param atlas Overwritten, only meaningful when parsing succeeds
+ * @return False on malformed JSON, more than ATLAS_MAX_FRAMES frames, or a frame outside the sheet
+ */
+bool Atlas_parse(Atlas *const atlas, char const *const json, size_t const len) {
+  memset(atlas, 0, sizeof(Atlas));
+  _Json j = {json, json + len, true};
+  char key[32];
+  bool first = true;
+
+  while (_Json_member(&j, key, sizeof(key), &first)) {
+    if (strcmp(key, "frames") == 0 && _Json_peek(&j, '[')) {
+      _Json_expect(&j, '[');
+      while (j.ok && !_Json_eat(&j, ']')) {
+        _Atlas_frame(atlas, &j);
+        if (!_Json_peek(&j, ']')) {
+          _Json_expect(&j, ',');
+        }
+      }
+    } else if (strcmp(key, "frames") == 0) {
+      bool frames_first = true;
+      while (_Json_member(&j, NULL, 0, &frames_first)) {
+        _Atlas_frame(atlas, &j);
+      }
+    } else if (strcmp(key, "meta") == 0) {
+      bool meta_first = true;
+      while (_Json_member(&j, key, sizeof(key), &meta_first)) {
+        if (strcmp(key, "size") == 0) {
+          _Json_rect(&j, NULL, NULL, &atlas->w, &atlas->h);
+        } else if (strcmp(key, "image") == 0) {
+          _Json_string(&j, atlas->image, sizeof(atlas->image));
+        } else {
+          _Json_skip(&j);
+        }
+      }
+    } else {
+      _Json_skip(&j);
+    }
+  }
+
+  if (!j.ok || atlas->cnt == 0) {
+    return false;
+  }
+
+  for (size_t i = 0; i < atlas->cnt; i++) {
+    AtlasFrame const *const f = &atlas->frames[i];
+    if (f->w == 0 || f->h == 0 || f->x + f->w > atlas->w || f->y + f->h > atlas->h) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Reads and parses an Aseprite sprite sheet JSON file.
+ *
+ * @return False when the file cannot be read or does not parse
+ */
+bool Atlas_load(Atlas *const atlas, char const *const path) {
+  FILE *const file = fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+
+  // Exports are a few hundred bytes per frame
+  char *const json = malloc(ATLAS_MAX_FRAMES * 1024);
+  if (json == NULL) {
+    fclose(file);
+    return false;
+  }
+  size_t const len = fread(json, 1, ATLAS_MAX_FRAMES * 1024, file);
+  bool const ok = !ferror(file) && feof(file) && Atlas_parse(atlas, json, len);
+
+  free(json);
+  fclose(file);
+  return ok;
+}
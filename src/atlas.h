@@ -0,0 +1,32 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ATLAS_MAX_FRAMES 64
+#define ATLAS_IMAGE_SIZE 64
+
+// A frame of an Aseprite sprite sheet export, in sheet pixels
+typedef struct {
+  uint16_t x, y, w, h;
+  // Size of the sprite before Aseprite trimmed it into the frame
+  uint16_t source_w, source_h;
+  uint16_t duration_ms;
+} AtlasFrame;
+
+// Frame table of one sprite sheet, loaded once and shared by everything drawn from it. Sprites are referred to by
+// their index into frames.
+typedef struct {
+  AtlasFrame frames[ATLAS_MAX_FRAMES];
+  size_t cnt;
+  uint16_t w, h;
+  // Sheet image file, relative to the JSON
+  char image[ATLAS_IMAGE_SIZE];
+} Atlas;
+
+bool Atlas_parse(Atlas *const atlas, char const *const json, size_t const len);
+bool Atlas_load(Atlas *const atlas, char const *const path);
+
+#endif
@@ -0,0 +1,108 @@
+#include "bag.h"
+
+#define PCG32_MULT 6364136223846793005ULL
+
+void Pcg32_seed(Pcg32 *const rng, uint64_t const seed) {
+  // The stream comes from the seed as well, so nearby seeds don't just shift one sequence
+  uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+  rng->state = 0;
+  rng->inc = (z ^ (z >> 31)) << 1 | 1;
+  Pcg32_next(rng);
+  rng->state += seed;
+  Pcg32_next(rng);
+}
+
+uint32_t Pcg32_next(Pcg32 *const rng) {
+  uint64_t const old = rng->state;
+  rng->state = old * PCG32_MULT + rng->inc;
+
+  uint32_t const xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+  uint32_t const rot = (uint32_t)(old >> 59);
+  return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+/**
+ * Jumps the generator as if Pcg32_next had been called delta times, in O(log delta).
+ */
+void Pcg32_advance(Pcg32 *const rng, uint64_t const delta) {
+  // Square-and-multiply on the affine step x -> mult * x + plus
+  uint64_t mult = PCG32_MULT, plus = rng->inc;
+  uint64_t acc_mult = 1, acc_plus = 0;
+
+  for (uint64_t d = delta; d > 0; d >>= 1) {
+    if (d & 1) {
+      acc_mult *= mult;
+      acc_plus = acc_plus * mult + plus;
+    }
+    plus *= mult + 1;
+    mult *= mult;
+  }
+
+  rng->state = acc_mult * rng->state + acc_plus;
+}
+
+static void _PieceBag_deal(PieceBag *const bag) {
+  for (uint8_t i = 0; i < BAG_SIZE; i++) {
+    bag->shapes[i] = i;
+  }
+
+  // Fisher-Yates with a multiply-shift instead of rejection sampling, so every bag costs the same draws. The bias is
+  // below 2^-29 for bounds this small.
+  for (uint8_t i = BAG_SIZE - 1; i > 0; i--) {
+    uint8_t const j = (uint8_t)(((uint64_t)Pcg32_next(&bag->rng) * (i + 1)) >> 32);
+    uint8_t const tmp = bag->shapes[i];
+    bag->shapes[i] = bag->shapes[j];
+    bag->shapes[j] = tmp;
+  }
+
+  bag->next = 0;
+}
+
+void PieceBag_init(PieceBag *const bag, uint64_t const seed) {
+  Pcg32_seed(&bag->rng, seed);
+  bag->next = BAG_SIZE;
+}
+
+uint8_t PieceBag_next(PieceBag *const bag) {
+  if (bag->next == BAG_SIZE) {
+    _PieceBag_deal(bag);
+  }
+
+  return bag->shapes[bag->next++];
+}
+
+/**
+ * Upcoming shapes, without dealing them.
+ *
+ * @param shapes Receives cnt shapes, the next one first
+ */
+void PieceBag_peek(PieceBag const *const bag, uint8_t *const shapes, size_t const cnt) {
+  PieceBag copy = *bag;
+  for (size_t i = 0; i < cnt; i++) {
+    shapes[i] = PieceBag_next(&copy);
+  }
+}
+
+/**
+ * Discards the next cnt shapes. Whole bags are skipped by jumping the generator, so the cost does not grow with cnt
+ * beyond the O(log cnt) jump.
+ */
+void PieceBag_skip(PieceBag *const bag, uint64_t const cnt) {
+  uint64_t const left = BAG_SIZE - bag->next;
+  if (cnt < left) {
+    bag->next += (uint8_t)cnt;
+    return;
+  }
+
+  uint64_t const rest = cnt - left;
+  Pcg32_advance(&bag->rng, rest / BAG_SIZE * (BAG_SIZE - 1));
+  bag->next = BAG_SIZE;
+
+  if (rest % BAG_SIZE != 0) {
+    _PieceBag_deal(bag);
+    bag->next = (uint8_t)(rest % BAG_SIZE);
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef BAG_H
+#define BAG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One of each shape per bag, dealt in a shuffled order
+#define BAG_SIZE 7
+
+// PCG32 (XSH RR), every game owns its generator so independent games share nothing
+typedef struct {
+  uint64_t state;
+  uint64_t inc;
+} Pcg32;
+
+// Every bag is shuffled with exactly BAG_SIZE - 1 draws, which is what lets skipping whole bags jump the generator
+typedef struct {
+  Pcg32 rng;
+  uint8_t shapes[BAG_SIZE];
+  // Index of the next shape in shapes, BAG_SIZE when a fresh bag has to be dealt first
+  uint8_t next;
+} PieceBag;
+
+void Pcg32_seed(Pcg32 *const rng, uint64_t const seed);
+uint32_t Pcg32_next(Pcg32 *const rng);
+void Pcg32_advance(Pcg32 *const rng, uint64_t const delta);
+
+void PieceBag_init(PieceBag *const bag, uint64_t const seed);
+uint8_t PieceBag_next(PieceBag *const bag);
+void PieceBag_peek(PieceBag const *const bag, uint8_t *const shapes, size_t const cnt);
+void PieceBag_skip(PieceBag *const bag, uint64_t const cnt);
+
+#endif
@@ -0,0 +1,17 @@
+#include "pack.h"
+#include <stdio.h>
+
+// Build step: tetris_bake <out.pak> <asset>...
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <out.pak> <asset>...\n", argv[0]);
+    return 2;
+  }
+
+  if (!AssetPack_bake(argv[1], (char const *const *)&argv[2], (size_t)(argc - 2))) {
+    fprintf(stderr, "%s: failed to bake %s\n", argv[0], argv[1]);
+    return 1;
+  }
+
+  return 0;
+}
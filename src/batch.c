@@ -0,0 +1,201 @@
+#include "batch.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint64_t _BatchSim_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t BatchSim_seed(uint64_t const seed, size_t const game_idx) {
+  // splitmix64, so neighbouring games get unrelated sequences
+  uint64_t z = seed + (game_idx + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+  return z ^ (z >> 31);
+}
+
+static void _BatchWorker_advance(BatchWorker *const worker, uint64_t const ticks) {
+  BatchSim *const sim = worker->sim;
+
+  for (size_t i = worker->first; i < worker->first + worker->cnt; i++) {
+    GameState *const game = sim->games[i];
+
+    for (uint64_t t = 0; t < ticks; t++) {
+      InputMask const input = sim->input != NULL ? sim->input(game, i, sim->input_ctx) : INPUT_NONE;
+
+      if (Game_step(game, input) == GAME_STATUS_OVER) {
+        worker->games_over++;
+        GameState_reset(game, BatchSim_seed(game->bag.rng.state, i));
+      }
+    }
+  }
+
+  worker->ticks += ticks * worker->cnt;
+}
+
+static void *_BatchWorker_main(void *arg) {
+  BatchWorker *const worker = arg;
+  BatchSim *const sim = worker->sim;
+
+  // Games are created on the thread that runs them, so their memory is first touched there. GameState_init puts every
+  // per-game allocation on whole cache lines, so no two workers' games ever share one.
+  for (size_t i = worker->first; i < worker->first + worker->cnt; i++) {
+    sim->games[i] = GameState_init(BatchSim_seed(sim->seed, i));
+  }
+
+  pthread_mutex_lock(&sim->lock);
+  uint64_t seen = sim->generation;
+  if (--sim->pending == 0) {
+    pthread_cond_signal(&sim->done);
+  }
+
+  for (;;) {
+    while (sim->generation == seen && !sim->quit) {
+      pthread_cond_wait(&sim->start, &sim->lock);
+    }
+
+    if (sim->quit) {
+      break;
+    }
+
+    seen = sim->generation;
+    uint64_t const ticks = sim->run_ticks;
+    pthread_mutex_unlock(&sim->lock);
+
+    _BatchWorker_advance(worker, ticks);
+
+    pthread_mutex_lock(&sim->lock);
+    if (--sim->pending == 0) {
+      pthread_cond_signal(&sim->done);
+    }
+  }
+
+  pthread_mutex_unlock(&sim->lock);
+
+  for (size_t i = worker->first; i < worker->first + worker->cnt; i++) {
+    GameState_free(sim->games[i]);
+  }
+
+  return NULL;
+}
+
+static void _BatchSim_wait(BatchSim *const sim) {
+  while (sim->pending > 0) {
+    pthread_cond_wait(&sim->done, &sim->lock);
+  }
+}
+
+/**
+ * Creates a pool of worker threads, each owning a contiguous slice of independent games.
+ *
+ * @param games Number of games to simulate
+ * @param threads Number of worker threads, clamped to the number of games
+ * @param seed Base seed, game i is seeded with BatchSim_seed(seed, i)
+ * @param input Input source called once per game per tick, or NULL for no input
+ * @param input_ctx Passed through to input
+ * @return NULL if a worker thread could not be started
+ */
+BatchSim *BatchSim_init(size_t const games, size_t const threads, uint64_t const seed, BatchInputFn const input,
+                        void *const input_ctx) {
+  assert(games > 0 && threads > 0 && "batch needs at least one game and one thread");
+
+  BatchSim *new = calloc(1, sizeof(BatchSim));
+  new->games = calloc(games, sizeof(GameState *));
+  new->games_cnt = games;
+  new->workers_cnt = threads < games ? threads : games;
+  new->workers = aligned_alloc(CACHE_LINE_SIZE, sizeof(BatchWorker) * new->workers_cnt);
+  new->seed = seed;
+  new->input = input;
+  new->input_ctx = input_ctx;
+  new->generation = 0;
+  new->run_ticks = 0;
+  new->pending = new->workers_cnt;
+  new->quit = false;
+  new->elapsed_ns = 0;
+
+  pthread_mutex_init(&new->lock, NULL);
+  pthread_cond_init(&new->start, NULL);
+  pthread_cond_init(&new->done, NULL);
+
+  for (size_t w = 0; w < new->workers_cnt; w++) {
+    BatchWorker *const worker = &new->workers[w];
+    size_t const first = games * w / new->workers_cnt;
+    size_t const last = games * (w + 1) / new->workers_cnt;
+
+    *worker = (BatchWorker){.sim = new, .first = first, .cnt = last - first, .ticks = 0, .games_over = 0};
+    if (pthread_create(&worker->thread, NULL, _BatchWorker_main, worker) != 0) {
+      // Only the workers already running are joined, they free their own games on the way out
+      new->workers_cnt = w;
+      BatchSim_free(new);
+      return NULL;
+    }
+  }
+
+  pthread_mutex_lock(&new->lock);
+  _BatchSim_wait(new);
+  pthread_mutex_unlock(&new->lock);
+
+  return new;
+}
+
+void BatchSim_free(BatchSim *sim) {
+  if (sim == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&sim->lock);
+  sim->quit = true;
+  pthread_cond_broadcast(&sim->start);
+  pthread_mutex_unlock(&sim->lock);
+
+  for (size_t w = 0; w < sim->workers_cnt; w++) {
+    pthread_join(sim->workers[w].thread, NULL);
+  }
+
+  pthread_cond_destroy(&sim->start);
+  pthread_cond_destroy(&sim->done);
+  pthread_mutex_destroy(&sim->lock);
+  free(sim->workers);
+  free(sim->games);
+  free(sim);
+}
+
+/**
+ * Advances every game by the same number of ticks, returning once all of them have.
+ */
+void BatchSim_run(BatchSim *const sim, uint64_t const ticks) {
+  uint64_t const start = _BatchSim_now_ns();
+
+  pthread_mutex_lock(&sim->lock);
+  sim->run_ticks = ticks;
+  sim->pending = sim->workers_cnt;
+  sim->generation++;
+  pthread_cond_broadcast(&sim->start);
+  _BatchSim_wait(sim);
+  pthread_mutex_unlock(&sim->lock);
+
+  sim->elapsed_ns += _BatchSim_now_ns() - start;
+}
+
+uint64_t BatchSim_ticks(BatchSim const *const sim) {
+  uint64_t ticks = 0;
+
+  for (size_t w = 0; w < sim->workers_cnt; w++) {
+    ticks += sim->workers[w].ticks;
+  }
+
+  return ticks;
+}
+
+double BatchSim_ticks_per_sec(BatchSim const *const sim) {
+  if (sim->elapsed_ns == 0) {
+    return 0.0;
+  }
+
+  return (double)BatchSim_ticks(sim) * 1e9 / (double)sim->elapsed_ns;
+}
@@ -0,0 +1,51 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "game.h"
+#include <pthread.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef InputMask (*BatchInputFn)(GameState const *const state, size_t const game_idx, void *const ctx);
+
+struct BatchSim;
+
+// Each worker sits on its own cache lines, so the counters it bumps every tick never false-share with a neighbour
+typedef struct {
+  alignas(CACHE_LINE_SIZE) pthread_t thread;
+  struct BatchSim *sim;
+  size_t first, cnt;
+  uint64_t ticks;
+  uint64_t games_over;
+} BatchWorker;
+
+typedef struct BatchSim {
+  GameState **games;
+  size_t games_cnt;
+  BatchWorker *workers;
+  size_t workers_cnt;
+  uint64_t seed;
+  BatchInputFn input;
+  void *input_ctx;
+
+  pthread_mutex_t lock;
+  pthread_cond_t start, done;
+  // Bumped once per BatchSim_run, workers advance their slice whenever it changes
+  uint64_t generation;
+  uint64_t run_ticks;
+  size_t pending;
+  bool quit;
+
+  uint64_t elapsed_ns;
+} BatchSim;
+
+uint64_t BatchSim_seed(uint64_t const seed, size_t const game_idx);
+BatchSim *BatchSim_init(size_t const games, size_t const threads, uint64_t const seed, BatchInputFn const input,
+                        void *const input_ctx);
+void BatchSim_free(BatchSim *sim);
+void BatchSim_run(BatchSim *const sim, uint64_t const ticks);
+uint64_t BatchSim_ticks(BatchSim const *const sim);
+double BatchSim_ticks_per_sec(BatchSim const *const sim);
+
+#endif
@@ -0,0 +1,328 @@
+#include "bot.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+const BotConfig BOT_CONFIG_DEFAULT = {
+    .depth = 3,
+    .beam = 16,
+    .threads = 0,
+    .tt_log2 = 18,
+    .weights = &EVAL_WEIGHTS_DEFAULT,
+};
+
+static inline uint64_t _Bot_pack(float const score) {
+  uint32_t bits;
+  memcpy(&bits, &score, sizeof(bits));
+  return bits;
+}
+
+static inline float _Bot_unpack(uint64_t const data) {
+  uint32_t const bits = (uint32_t)data;
+  float score;
+  memcpy(&score, &bits, sizeof(score));
+  return score;
+}
+
+// Boards score the same whatever led to them, so their score is cached by hash across branches and plans. Lines are
+// left out and added by the caller, the evaluator being linear in them.
+static bool _Bot_cached(Bot const *const bot, BotWorkspace *const ws, uint64_t const hash, float *const score) {
+  uint64_t data;
+  if (bot->tt == NULL || !TransTable_probe(bot->tt, hash, &data)) {
+    return false;
+  }
+
+  ws->stats.tt_hits++;
+  *score = _Bot_unpack(data);
+  return true;
+}
+
+static float _Bot_evaluate(Bot const *const bot, BotWorkspace *const ws, TetrominoWell const *const w) {
+  EvalFeatures const f = TetrominoWell_features(w);
+  float const score = Eval_score(bot->cfg.weights, &f);
+
+  ws->stats.evals++;
+  if (bot->tt != NULL) {
+    TransTable_store(bot->tt, w->hash, _Bot_pack(score));
+  }
+  return score;
+}
+
+static int32_t _Bot_build(TetrominoWell *const dst, TetrominoWell const *const parent, Tetromino const *const t) {
+  TetrominoWell_copy(dst, parent);
+  TetrominoWell_place(dst, t);
+  return (int32_t)TetrominoWell_clear_full_rows(dst);
+}
+
+/**
+ * Beam search below one first placement: every board of a level tries every placement of the next preview piece and
+ * the best cfg.beam distinct children make up the next level. Boards are swapped in and out of the workspace, never
+ * allocated, and a child is only built when its hash misses the transposition table or it makes the beam.
+ */
+static void _Bot_branch(SchedWorker *const worker, void *const arg) {
+  BotBranch *const branch = arg;
+  Bot const *const bot = branch->bot;
+  BotWorkspace *const ws = &bot->spaces[worker->id];
+  float const line_weight = bot->cfg.weights->lines;
+
+  TetrominoWell *const first = ws->beam[0][0];
+  Tetromino const t = Placement_tetromino(branch->placement, bot->state->active->shape);
+  ws->lines[0][0] = _Bot_build(first, bot->state->well, &t);
+  ws->hash[0][0] = first->hash;
+  float board;
+  if (!_Bot_cached(bot, ws, first->hash, &board)) {
+    board = _Bot_evaluate(bot, ws, first);
+  }
+  ws->score[0][0] = board + line_weight * (float)ws->lines[0][0];
+
+  size_t cur = 0, cnt = 1;
+  for (size_t d = 1; d < bot->depth && cnt > 0; d++) {
+    size_t const next = cur ^ 1;
+    size_t next_cnt = 0, worst = 0;
+
+    for (size_t b = 0; b < cnt; b++) {
+      TetrominoWell const *const parent = ws->beam[cur][b];
+      TetrominoPool *const pool = ws->scratch->pool;
+      Tetromino *const spawn = Tetromino_init(pool, bot->preview[d - 1], 0, (parent->cols - 1) / 2);
+
+      // A piece that cannot spawn tops out, the board gets no children
+      size_t const placements =
+          TetrominoWell_collision(parent, spawn, 0, 0) ? 0 : MoveGen_placements(ws->gen, parent, spawn);
+
+      for (size_t k = 0; k < placements; k++) {
+        Tetromino const child = Placement_tetromino(ws->gen->placements[k], spawn->shape);
+        int32_t lines = ws->lines[cur][b];
+        bool built = false;
+
+        // Without a clear the child's hash is four XORs away from the parent's, no need to build it to look it up
+        uint64_t hash = 0;
+        if (TetrominoWell_place_clears(parent, &child) ||
+            !_Bot_cached(bot, ws, hash = TetrominoWell_place_hash(parent, &child), &board)) {
+          lines += _Bot_build(ws->scratch, parent, &child);
+          built = true;
+          hash = ws->scratch->hash;
+          if (!_Bot_cached(bot, ws, hash, &board)) {
+            board = _Bot_evaluate(bot, ws, ws->scratch);
+          }
+        }
+        float const score = board + line_weight * (float)lines;
+
+        // The same board through another parent only differs in lines cleared, keep the better one
+        size_t slot = next_cnt;
+        for (size_t i = 0; i < next_cnt; i++) {
+          slot = ws->hash[next][i] == hash ? i : slot;
+        }
+
+        if (slot < next_cnt) {
+          if (score <= ws->score[next][slot]) {
+            continue;
+          }
+        } else if (next_cnt < bot->cfg.beam) {
+          next_cnt++;
+        } else if (score > ws->score[next][worst]) {
+          slot = worst;
+        } else {
+          continue;
+        }
+
+        if (!built) {
+          _Bot_build(ws->scratch, parent, &child);
+        }
+
+        TetrominoWell *const kept = ws->scratch;
+        ws->scratch = ws->beam[next][slot];
+        ws->beam[next][slot] = kept;
+        ws->score[next][slot] = score;
+        ws->lines[next][slot] = lines;
+        ws->hash[next][slot] = hash;
+
+        worst = 0;
+        for (size_t i = 1; i < next_cnt; i++) {
+          worst = ws->score[next][i] < ws->score[next][worst] ? i : worst;
+        }
+      }
+
+      Tetromino_free(pool, spawn);
+    }
+
+    cur = next;
+    cnt = next_cnt;
+  }
+
+  branch->score = -INFINITY;
+  for (size_t i = 0; i < cnt; i++) {
+    branch->score = fmaxf(branch->score, ws->score[cur][i]);
+  }
+}
+
+static void _Bot_root(SchedWorker *const worker, void *const arg) {
+  Bot *const bot = arg;
+
+  for (size_t i = 0; i < bot->branches_cnt; i++) {
+    BotBranch *const branch = &bot->branches[i];
+    branch->bot = bot;
+    branch->placement = bot->root->placements[i];
+    Scheduler_spawn(worker, &bot->group, &branch->task, _Bot_branch, branch);
+  }
+
+  Scheduler_wait(worker, &bot->group);
+}
+
+/**
+ * @return NULL if the search threads could not be started
+ */
+Bot *Bot_init(BotConfig const *const cfg) {
+  assert(cfg->depth > 0 && cfg->depth <= BOT_MAX_DEPTH && "bot depth out of range");
+  assert(cfg->beam > 0 && cfg->beam <= BOT_MAX_BEAM && "bot beam out of range");
+
+  Bot *new = calloc(1, sizeof(Bot));
+  new->cfg = *cfg;
+  if (new->cfg.threads == 0) {
+    long const online = sysconf(_SC_NPROCESSORS_ONLN);
+    new->cfg.threads = online > 0 ? (size_t)online : 1;
+  }
+
+  new->sched = Scheduler_init(new->cfg.threads);
+  if (new->sched == NULL) {
+    free(new);
+    return NULL;
+  }
+  new->spaces_cnt = new->cfg.threads;
+  new->spaces = calloc(new->spaces_cnt, sizeof(BotWorkspace));
+  for (size_t i = 0; i < new->spaces_cnt; i++) {
+    BotWorkspace *const ws = &new->spaces[i];
+    ws->gen = calloc(1, sizeof(MoveGen));
+    ws->scratch = TetrominoWell_init(WELL_ROWS, WELL_COLS);
+    for (size_t b = 0; b < new->cfg.beam; b++) {
+      ws->beam[0][b] = TetrominoWell_init(WELL_ROWS, WELL_COLS);
+      ws->beam[1][b] = TetrominoWell_init(WELL_ROWS, WELL_COLS);
+    }
+  }
+
+  new->tt = new->cfg.tt_log2 > 0 ? TransTable_init(new->cfg.tt_log2) : NULL;
+  new->root = calloc(1, sizeof(MoveGen));
+  new->branches = calloc(SCHED_DEQUE_CAP, sizeof(BotBranch));
+
+  return new;
+}
+
+void Bot_free(Bot *bot) {
+  if (bot == NULL) {
+    return;
+  }
+
+  Scheduler_free(bot->sched);
+  for (size_t i = 0; i < bot->spaces_cnt; i++) {
+    BotWorkspace *const ws = &bot->spaces[i];
+    free(ws->gen);
+    TetrominoWell_free(ws->scratch);
+    for (size_t b = 0; b < bot->cfg.beam; b++) {
+      TetrominoWell_free(ws->beam[0][b]);
+      TetrominoWell_free(ws->beam[1][b]);
+    }
+  }
+  free(bot->spaces);
+  TransTable_free(bot->tt);
+  free(bot->root);
+  free(bot->branches);
+  free(bot);
+}
+
+/**
+ * Forgets the current plan. Piece numbers start over with every game, so this must follow every GameState_reset of
+ * the game the bot plays.
+ */
+void Bot_reset(Bot *const bot) {
+  bot->piece = 0;
+  bot->planned = false;
+}
+
+// Work done by every search so far, summed over threads
+BotStats Bot_stats(Bot const *const bot) {
+  BotStats stats = {0};
+  for (size_t i = 0; i < bot->spaces_cnt; i++) {
+    stats.evals += bot->spaces[i].stats.evals;
+    stats.tt_hits += bot->spaces[i].stats.tt_hits;
+  }
+  return stats;
+}
+
+/**
+ * Searches the best placement for the active piece, looking cfg.depth - 1 pieces into the preview, or as far as the
+ * game's preview goes.
+ *
+ * Every placement of the active piece becomes a task for the work-stealing scheduler, each beam searching the rest of
+ * the preview on whichever thread picked it up.
+ *
+ * @param best Receives the placement with the best board at the bottom of its beam
+ * @return False when there is no active piece or nowhere to put it
+ */
+bool Bot_plan(Bot *const bot, GameState const *const state, Placement *const best) {
+  if (state->active == NULL) {
+    return false;
+  }
+
+  assert(state->well->rows == WELL_ROWS && state->well->cols == WELL_COLS && "bot boards are WELL_ROWS x WELL_COLS");
+
+  size_t const found = MoveGen_placements(bot->root, state->well, state->active);
+  if (found == 0) {
+    return false;
+  }
+  // Every branch is queued on the caller's deque at once. A board this size never has that many placements, but
+  // one that did only has its first SCHED_DEQUE_CAP searched.
+  size_t const cnt = found < SCHED_DEQUE_CAP ? found : SCHED_DEQUE_CAP;
+  bot->branches_cnt = cnt;
+
+  bot->state = state;
+  // The bot only knows what the player would, pieces past the preview are not searched
+  bot->depth = 1 + (bot->cfg.depth - 1 < state->preview ? bot->cfg.depth - 1 : state->preview);
+  Game_preview(state, bot->preview, bot->depth - 1);
+  Scheduler_run(bot->sched, _Bot_root, bot);
+
+  size_t pick = 0;
+  for (size_t i = 1; i < cnt; i++) {
+    pick = bot->branches[i].score > bot->branches[pick].score ? i : pick;
+  }
+  *best = bot->branches[pick].placement;
+
+  return true;
+}
+
+/**
+ * Input for this tick, a drop-in replacement for keyboard input.
+ *
+ * Plans once per piece, then walks the path to the planned placement one input per tick and hard drops as soon as only
+ * drops are left. The path is recomputed every tick, so gravity pulling the piece along is taken into account.
+ */
+InputMask Bot_input(Bot *const bot, GameState const *const state) {
+  if (state->status != GAME_STATUS_PLAYING || state->active == NULL) {
+    return INPUT_NONE;
+  }
+
+  if (bot->piece != state->pieces) {
+    bot->piece = state->pieces;
+    bot->planned = Bot_plan(bot, state, &bot->target);
+  }
+
+  size_t len = bot->planned ? MoveGen_path(bot->root, state->well, state->active, bot->target, bot->path, BOT_PATH_CAP)
+                            : MOVEGEN_NO_PATH;
+  if (len == MOVEGEN_NO_PATH) {
+    // The piece was pulled past the plan, pick the best of what is still reachable
+    bot->planned = Bot_plan(bot, state, &bot->target);
+    len = bot->planned ? MoveGen_path(bot->root, state->well, state->active, bot->target, bot->path, BOT_PATH_CAP)
+                       : MOVEGEN_NO_PATH;
+    if (len == MOVEGEN_NO_PATH) {
+      return INPUT_HARD_DROP;
+    }
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    if (i >= BOT_PATH_CAP || bot->path[i] != INPUT_SOFT_DROP) {
+      return bot->path[0];
+    }
+  }
+
+  return INPUT_HARD_DROP;
+}
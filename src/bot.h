@@ -0,0 +1,93 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "eval.h"
+#include "game.h"
+#include "movegen.h"
+#include "scheduler.h"
+#include "ttable.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BOT_MAX_DEPTH 8
+#define BOT_MAX_BEAM 64
+// Longest path the bot keeps around, anything longer is replanned as it goes
+#define BOT_PATH_CAP 64
+
+typedef struct {
+  // Most pieces searched, the active one plus depth - 1 from the preview. Games with a shorter preview are searched
+  // as deep as their preview goes.
+  size_t depth;
+  // Boards kept per level below each first placement
+  size_t beam;
+  // Search threads including the caller, 0 for one per online CPU
+  size_t threads;
+  // Transposition table of 1 << tt_log2 board scores shared by all threads, 0 to search without one
+  size_t tt_log2;
+  EvalWeights const *weights;
+} BotConfig;
+
+extern const BotConfig BOT_CONFIG_DEFAULT;
+
+typedef struct {
+  // Boards evaluated, and boards whose score came from the transposition table instead
+  uint64_t evals;
+  uint64_t tt_hits;
+} BotStats;
+
+// Scratch space of one search thread, so subtrees run without allocating
+typedef struct {
+  MoveGen *gen;
+  TetrominoWell *scratch;
+  TetrominoWell *beam[2][BOT_MAX_BEAM];
+  float score[2][BOT_MAX_BEAM];
+  int32_t lines[2][BOT_MAX_BEAM];
+  uint64_t hash[2][BOT_MAX_BEAM];
+  BotStats stats;
+} BotWorkspace;
+
+struct Bot;
+
+// One first placement of the active piece, searched as its own task
+typedef struct {
+  struct Bot *bot;
+  Placement placement;
+  float score;
+  SchedTask task;
+} BotBranch;
+
+typedef struct Bot {
+  BotConfig cfg;
+  Scheduler *sched;
+  TransTable *tt;
+  BotWorkspace *spaces;
+  size_t spaces_cnt;
+
+  MoveGen *root;
+  // One per placement searched, at most SCHED_DEQUE_CAP of them
+  BotBranch *branches;
+  size_t branches_cnt;
+  SchedGroup group;
+
+  // Game being searched, read-only while the scheduler runs
+  GameState const *state;
+  ETetrominoShape preview[BOT_MAX_DEPTH];
+  // Pieces searched by the current plan, cfg.depth cut down to what the game's preview shows
+  size_t depth;
+
+  // Piece the current plan is for, see GameState.pieces
+  uint64_t piece;
+  bool planned;
+  Placement target;
+  InputMask path[BOT_PATH_CAP];
+} Bot;
+
+Bot *Bot_init(BotConfig const *const cfg);
+void Bot_free(Bot *bot);
+void Bot_reset(Bot *const bot);
+bool Bot_plan(Bot *const bot, GameState const *const state, Placement *const best);
+InputMask Bot_input(Bot *const bot, GameState const *const state);
+BotStats Bot_stats(Bot const *const bot);
+
+#endif
@@ -0,0 +1,339 @@
+#include "collide.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+// The kernels work on 64 bit lanes and move them in and out of general registers, which only x86-64 has
+#if defined(__x86_64__)
+#define COLLIDE_X86 1
+#include <immintrin.h>
+#endif
+
+typedef struct {
+  ColMask (*legal_cols)(TetrominoWell const *, ETetrominoShape, size_t, ptrdiff_t);
+  bool (*legal)(TetrominoWell const *, Tetromino const *);
+  // NULL when the kernel has no batch form, candidates are then tested one at a time with legal
+  void (*legal_batch)(TetrominoWell const *, Tetromino const *, size_t, uint64_t *);
+} CollideKernel;
+
+// Per shape and rotation, the box rows as 64 bit lanes, and for each box column the lanes with a mino in it
+typedef struct {
+  uint64_t rows[MINO_CNT];
+  uint64_t sel[MINO_CNT][MINO_CNT];
+} _CollideLanes;
+
+static _CollideLanes COLLIDE_LANES[TETROMINO_SHAPE_CNT][TETROMINO_ROTATION_CNT];
+static pthread_once_t COLLIDE_ONCE = PTHREAD_ONCE_INIT;
+static _Atomic ECollideKernel COLLIDE_KERNEL = COLLIDE_KERNEL_SCALAR;
+
+/**
+ * Row of the well shifted into ColMask space, with the walls on either side and everything outside the well filled so
+ * that a single AND tests bounds and locked minos together.
+ */
+static inline uint64_t _Collide_row(TetrominoWell const *const w, ptrdiff_t const row) {
+  if (row < 0 || row >= (ptrdiff_t)w->rows) {
+    return ~0ULL;
+  }
+
+  WellWord const *const bits = &w->bits[(size_t)row * w->words];
+  uint64_t filled = bits[0];
+  if (w->words > 1) {
+    filled |= (uint64_t)bits[1] << WELL_WORD_BITS;
+  }
+
+  uint64_t const inside = ((1ULL << w->cols) - 1) << COLLIDE_COL_BIAS;
+  return (filled << COLLIDE_COL_BIAS) | ~inside;
+}
+
+// Positions whose bounding box starts inside the ColMask, anything further right hits the wall anyway
+static inline ColMask _Collide_positions(TetrominoWell const *const w) {
+  return (1ULL << (w->cols + COLLIDE_COL_BIAS)) - 1;
+}
+
+static inline bool _Collide_in_range(Tetromino const *const t) {
+  ptrdiff_t const col = (ptrdiff_t)t->col0 + COLLIDE_COL_BIAS;
+  return col >= 0 && col < 64 - MINO_CNT;
+}
+
+static ColMask _Collide_legal_cols_scalar(TetrominoWell const *const w, ETetrominoShape const shape,
+                                          size_t const rotation, ptrdiff_t const row0) {
+  TetrominoRotation const *const rot = &TETROMINO_ROTATIONS[shape][rotation];
+  uint64_t hit = 0;
+
+  for (size_t r = 0; r < MINO_CNT; r++) {
+    if (rot->rows[r] == 0) {
+      continue;
+    }
+
+    // Position i puts a mino of box column j on bit i + j, so it collides when the row has bit i + j set
+    uint64_t const filled = _Collide_row(w, row0 + (ptrdiff_t)r);
+    for (uint8_t m = rot->rows[r]; m; m &= m - 1) {
+      hit |= filled >> __builtin_ctz(m);
+    }
+  }
+
+  return ~hit & _Collide_positions(w);
+}
+
+static bool _Collide_legal_scalar(TetrominoWell const *const w, Tetromino const *const t) {
+  _CollideLanes const *const lanes = &COLLIDE_LANES[t->shape][t->deg / 90];
+  size_t const shift = t->col0 + COLLIDE_COL_BIAS;
+
+  for (size_t r = 0; r < MINO_CNT; r++) {
+    if (lanes->rows[r] && (lanes->rows[r] << shift) & _Collide_row(w, (ptrdiff_t)t->row0 + (ptrdiff_t)r)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+#ifdef COLLIDE_X86
+// The four box rows fill two SSE2 registers or one AVX2 register. A candidate shifts every lane by the same column,
+// so SSE2 can test single placements as well.
+
+__attribute__((target("sse2"))) static ColMask
+_Collide_legal_cols_sse2(TetrominoWell const *const w, ETetrominoShape const shape, size_t const rotation,
+                         ptrdiff_t const row0) {
+  _CollideLanes const *const lanes = &COLLIDE_LANES[shape][rotation];
+  __m128i const lo = _mm_set_epi64x((long long)_Collide_row(w, row0 + 1), (long long)_Collide_row(w, row0));
+  __m128i const hi = _mm_set_epi64x((long long)_Collide_row(w, row0 + 3), (long long)_Collide_row(w, row0 + 2));
+  __m128i const *const sel = (__m128i const *)lanes->sel;
+
+  // sel[2j] and sel[2j + 1] hold lanes 0-1 and 2-3 of box column j
+  __m128i hit = _mm_and_si128(lo, _mm_loadu_si128(&sel[0]));
+  hit = _mm_or_si128(hit, _mm_and_si128(hi, _mm_loadu_si128(&sel[1])));
+  hit = _mm_or_si128(hit, _mm_and_si128(_mm_srli_epi64(lo, 1), _mm_loadu_si128(&sel[2])));
+  hit = _mm_or_si128(hit, _mm_and_si128(_mm_srli_epi64(hi, 1), _mm_loadu_si128(&sel[3])));
+  hit = _mm_or_si128(hit, _mm_and_si128(_mm_srli_epi64(lo, 2), _mm_loadu_si128(&sel[4])));
+  hit = _mm_or_si128(hit, _mm_and_si128(_mm_srli_epi64(hi, 2), _mm_loadu_si128(&sel[5])));
+  hit = _mm_or_si128(hit, _mm_and_si128(_mm_srli_epi64(lo, 3), _mm_loadu_si128(&sel[6])));
+  hit = _mm_or_si128(hit, _mm_and_si128(_mm_srli_epi64(hi, 3), _mm_loadu_si128(&sel[7])));
+  hit = _mm_or_si128(hit, _mm_unpackhi_epi64(hit, hit));
+
+  return ~(uint64_t)_mm_cvtsi128_si64(hit) & _Collide_positions(w);
+}
+
+__attribute__((target("sse2"))) static bool _Collide_legal_sse2(TetrominoWell const *const w,
+                                                                Tetromino const *const t) {
+  _CollideLanes const *const lanes = &COLLIDE_LANES[t->shape][t->deg / 90];
+  ptrdiff_t const row0 = (ptrdiff_t)t->row0;
+  __m128i const shift = _mm_cvtsi32_si128((int)(t->col0 + COLLIDE_COL_BIAS));
+
+  __m128i const lo = _mm_set_epi64x((long long)_Collide_row(w, row0 + 1), (long long)_Collide_row(w, row0));
+  __m128i const hi = _mm_set_epi64x((long long)_Collide_row(w, row0 + 3), (long long)_Collide_row(w, row0 + 2));
+  __m128i const minos_lo = _mm_sll_epi64(_mm_loadu_si128((__m128i const *)&lanes->rows[0]), shift);
+  __m128i const minos_hi = _mm_sll_epi64(_mm_loadu_si128((__m128i const *)&lanes->rows[2]), shift);
+
+  __m128i const hit = _mm_or_si128(_mm_and_si128(lo, minos_lo), _mm_and_si128(hi, minos_hi));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(hit, _mm_setzero_si128())) == 0xFFFF;
+}
+
+__attribute__((target("avx2"))) static ColMask
+_Collide_legal_cols_avx2(TetrominoWell const *const w, ETetrominoShape const shape, size_t const rotation,
+                         ptrdiff_t const row0) {
+  _CollideLanes const *const lanes = &COLLIDE_LANES[shape][rotation];
+  __m256i const rows = _mm256_set_epi64x((long long)_Collide_row(w, row0 + 3), (long long)_Collide_row(w, row0 + 2),
+                                         (long long)_Collide_row(w, row0 + 1), (long long)_Collide_row(w, row0));
+  __m256i const *const sel = (__m256i const *)lanes->sel;
+
+  __m256i hit = _mm256_and_si256(rows, _mm256_loadu_si256(&sel[0]));
+  hit = _mm256_or_si256(hit, _mm256_and_si256(_mm256_srli_epi64(rows, 1), _mm256_loadu_si256(&sel[1])));
+  hit = _mm256_or_si256(hit, _mm256_and_si256(_mm256_srli_epi64(rows, 2), _mm256_loadu_si256(&sel[2])));
+  hit = _mm256_or_si256(hit, _mm256_and_si256(_mm256_srli_epi64(rows, 3), _mm256_loadu_si256(&sel[3])));
+
+  __m128i half = _mm_or_si128(_mm256_castsi256_si128(hit), _mm256_extracti128_si256(hit, 1));
+  half = _mm_or_si128(half, _mm_unpackhi_epi64(half, half));
+
+  return ~(uint64_t)_mm_cvtsi128_si64(half) & _Collide_positions(w);
+}
+
+__attribute__((target("avx2"))) static bool _Collide_legal_avx2(TetrominoWell const *const w,
+                                                                Tetromino const *const t) {
+  _CollideLanes const *const lanes = &COLLIDE_LANES[t->shape][t->deg / 90];
+  ptrdiff_t const row0 = (ptrdiff_t)t->row0;
+  __m128i const shift = _mm_cvtsi32_si128((int)(t->col0 + COLLIDE_COL_BIAS));
+
+  __m256i const rows = _mm256_set_epi64x((long long)_Collide_row(w, row0 + 3), (long long)_Collide_row(w, row0 + 2),
+                                         (long long)_Collide_row(w, row0 + 1), (long long)_Collide_row(w, row0));
+  __m256i const minos = _mm256_sll_epi64(_mm256_loadu_si256((__m256i const *)lanes->rows), shift);
+
+  return _mm256_testz_si256(rows, minos);
+}
+
+/**
+ * Tests four candidates per step, one per 64 bit lane. Each lane gathers its own box rows from the well and its own
+ * mino rows from COLLIDE_LANES, then shifts them by its own column.
+ */
+__attribute__((target("avx2"))) static void _Collide_legal_batch_avx2(TetrominoWell const *const w,
+                                                                      Tetromino const *const ts, size_t const cnt,
+                                                                      uint64_t *const legal) {
+  memset(legal, 0, (cnt + 63) / 64 * sizeof(uint64_t));
+  if (w->rows > COLLIDE_BATCH_MAX_ROWS) {
+    for (size_t i = 0; i < cnt; i++) {
+      legal[i / 64] |= (uint64_t)(_Collide_in_range(&ts[i]) && _Collide_legal_avx2(w, &ts[i])) << (i % 64);
+    }
+    return;
+  }
+
+  // Well rows with MINO_CNT rows of wall above and below. A box anywhere outside them only covers wall, so its row is
+  // clamped onto the padding instead of bounds checked per lane.
+  uint64_t padded[COLLIDE_BATCH_MAX_ROWS + 2 * MINO_CNT];
+  ptrdiff_t const top = (ptrdiff_t)w->rows + MINO_CNT;
+  for (ptrdiff_t p = 0; p < top + MINO_CNT; p++) {
+    padded[p] = _Collide_row(w, p - MINO_CNT);
+  }
+
+  size_t const stride = sizeof(_CollideLanes) / sizeof(uint64_t);
+  size_t i = 0;
+  for (; i + 4 <= cnt; i += 4) {
+    long long row[4], lane[4], shift[4];
+    int in_range = 0;
+
+    for (size_t k = 0; k < 4; k++) {
+      Tetromino const *const t = &ts[i + k];
+      ptrdiff_t const p = (ptrdiff_t)t->row0 + MINO_CNT;
+      row[k] = p < 0 ? 0 : p > top ? top : p;
+      lane[k] = (long long)((t->shape * TETROMINO_ROTATION_CNT + t->deg / 90) * stride);
+      shift[k] = (long long)(t->col0 + COLLIDE_COL_BIAS);
+      in_range |= _Collide_in_range(t) << k;
+    }
+
+    __m256i const rows = _mm256_loadu_si256((__m256i const *)row);
+    __m256i const lanes = _mm256_loadu_si256((__m256i const *)lane);
+    __m256i const shifts = _mm256_loadu_si256((__m256i const *)shift);
+    __m256i hit = _mm256_setzero_si256();
+
+    for (long long r = 0; r < MINO_CNT; r++) {
+      __m256i const next = _mm256_set1_epi64x(r);
+      __m256i const filled = _mm256_i64gather_epi64((long long const *)padded, _mm256_add_epi64(rows, next), 8);
+      __m256i const minos =
+          _mm256_i64gather_epi64((long long const *)COLLIDE_LANES, _mm256_add_epi64(lanes, next), 8);
+      hit = _mm256_or_si256(hit, _mm256_and_si256(filled, _mm256_sllv_epi64(minos, shifts)));
+    }
+
+    int const fits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(hit, _mm256_setzero_si256())));
+    // i is a multiple of 4, so the four bits never straddle two words
+    legal[i / 64] |= (uint64_t)(fits & in_range) << (i % 64);
+  }
+
+  for (; i < cnt; i++) {
+    legal[i / 64] |= (uint64_t)(_Collide_in_range(&ts[i]) && _Collide_legal_avx2(w, &ts[i])) << (i % 64);
+  }
+}
+#endif
+
+static CollideKernel const COLLIDE_KERNELS[COLLIDE_KERNEL_CNT] = {
+    [COLLIDE_KERNEL_SCALAR] = {_Collide_legal_cols_scalar, _Collide_legal_scalar, NULL},
+#ifdef COLLIDE_X86
+    [COLLIDE_KERNEL_SSE2] = {_Collide_legal_cols_sse2, _Collide_legal_sse2, NULL},
+    [COLLIDE_KERNEL_AVX2] = {_Collide_legal_cols_avx2, _Collide_legal_avx2, _Collide_legal_batch_avx2},
+#endif
+};
+
+static void _Collide_init(void) {
+  for (size_t s = 0; s < TETROMINO_SHAPE_CNT; s++) {
+    for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+      TetrominoRotation const *const rot = &TETROMINO_ROTATIONS[s][q];
+      _CollideLanes *const lanes = &COLLIDE_LANES[s][q];
+
+      for (size_t r = 0; r < MINO_CNT; r++) {
+        lanes->rows[r] = rot->rows[r];
+      }
+
+      // AVX2 reads sel[j] as the four lanes of box column j, SSE2 reads the same memory as pairs of lanes
+      for (size_t j = 0; j < MINO_CNT; j++) {
+        for (size_t r = 0; r < MINO_CNT; r++) {
+          lanes->sel[j][r] = (rot->rows[r] >> j) & 1 ? ~0ULL : 0;
+        }
+      }
+    }
+  }
+
+  ECollideKernel kernel = COLLIDE_KERNEL_SCALAR;
+  for (ECollideKernel k = COLLIDE_KERNEL_SCALAR; k < COLLIDE_KERNEL_CNT; k++) {
+    if (Collide_kernel_supported(k)) {
+      kernel = k;
+    }
+  }
+  atomic_store_explicit(&COLLIDE_KERNEL, kernel, memory_order_relaxed);
+}
+
+static inline CollideKernel const *_Collide_dispatch(void) {
+  pthread_once(&COLLIDE_ONCE, _Collide_init);
+  return &COLLIDE_KERNELS[atomic_load_explicit(&COLLIDE_KERNEL, memory_order_relaxed)];
+}
+
+/**
+ * @return Kernel picked for this CPU, the widest one it supports unless overridden with Collide_set_kernel
+ */
+ECollideKernel Collide_kernel(void) {
+  pthread_once(&COLLIDE_ONCE, _Collide_init);
+  return atomic_load_explicit(&COLLIDE_KERNEL, memory_order_relaxed);
+}
+
+bool Collide_kernel_supported(ECollideKernel const kernel) {
+  switch (kernel) {
+  case COLLIDE_KERNEL_SCALAR:
+    return true;
+#ifdef COLLIDE_X86
+  case COLLIDE_KERNEL_SSE2:
+    return __builtin_cpu_supports("sse2");
+  case COLLIDE_KERNEL_AVX2:
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+// Mostly for tests and benchmarks comparing kernels, affects every thread
+void Collide_set_kernel(ECollideKernel const kernel) {
+  assert(Collide_kernel_supported(kernel) && "kernel not supported on this CPU");
+  pthread_once(&COLLIDE_ONCE, _Collide_init);
+  atomic_store_explicit(&COLLIDE_KERNEL, kernel, memory_order_relaxed);
+}
+
+/**
+ * Tests one rotation at every column of a row at once.
+ *
+ * @param w Well, at most COLLIDE_MAX_COLS wide
+ * @param row0 Row of the bounding box, may be negative or past the floor, where nothing is legal
+ * @return Bit col0 + COLLIDE_COL_BIAS set for every col0 the rotation fits at
+ */
+ColMask TetrominoWell_legal_cols(TetrominoWell const *const w, ETetrominoShape const shape, size_t const rotation,
+                                 ptrdiff_t const row0) {
+  assert(w->cols <= COLLIDE_MAX_COLS && "well too wide for collision kernels");
+  assert(shape < TETROMINO_SHAPE_CNT && rotation < TETROMINO_ROTATION_CNT);
+  return _Collide_dispatch()->legal_cols(w, shape, rotation, row0);
+}
+
+/**
+ * Tests a batch of candidate placements. The AVX2 kernel tests four candidates at a time, the others loop over their
+ * single placement test.
+ *
+ * @param ts Candidates, any shape, rotation or offset
+ * @param legal Bit i % 64 of legal[i / 64] set when ts[i] fits, needs (cnt + 63) / 64 words
+ */
+void TetrominoWell_legal_batch(TetrominoWell const *const w, Tetromino const *const ts, size_t const cnt,
+                               uint64_t *const legal) {
+  assert(w->cols <= COLLIDE_MAX_COLS && "well too wide for collision kernels");
+  CollideKernel const *const kernel = _Collide_dispatch();
+  if (kernel->legal_batch != NULL) {
+    kernel->legal_batch(w, ts, cnt, legal);
+    return;
+  }
+
+  for (size_t i = 0; i < cnt; i += 64) {
+    uint64_t word = 0;
+    size_t const end = cnt - i < 64 ? cnt - i : 64;
+
+    for (size_t k = 0; k < end; k++) {
+      Tetromino const *const t = &ts[i + k];
+      word |= (uint64_t)(_Collide_in_range(t) && kernel->legal(w, t)) << k;
+    }
+    legal[i / 64] = word;
+  }
+}
@@ -0,0 +1,33 @@
+#ifndef COLLIDE_H
+#define COLLIDE_H
+
+#include "game.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Bit i of a ColMask stands for col0 = i - COLLIDE_COL_BIAS, so boxes hanging over the left wall still get a bit
+#define COLLIDE_COL_BIAS MINO_CNT
+// Leaves room for the bias and for a bounding box hanging over the right wall
+#define COLLIDE_MAX_COLS (64 - COLLIDE_COL_BIAS - MINO_CNT)
+// Tallest well the AVX2 batch test keeps on the stack, taller ones are tested one candidate at a time
+#define COLLIDE_BATCH_MAX_ROWS 64
+
+typedef uint64_t ColMask;
+
+typedef enum {
+  COLLIDE_KERNEL_SCALAR,
+  COLLIDE_KERNEL_SSE2,
+  COLLIDE_KERNEL_AVX2,
+  COLLIDE_KERNEL_CNT,
+} ECollideKernel;
+
+ECollideKernel Collide_kernel(void);
+bool Collide_kernel_supported(ECollideKernel const kernel);
+void Collide_set_kernel(ECollideKernel const kernel);
+
+ColMask TetrominoWell_legal_cols(TetrominoWell const *const w, ETetrominoShape const shape, size_t const rotation,
+                                 ptrdiff_t const row0);
+void TetrominoWell_legal_batch(TetrominoWell const *const w, Tetromino const *const ts, size_t const cnt,
+                               uint64_t *const legal);
+
+#endif
@@ -0,0 +1,92 @@
+#include "eval.h"
+#include <assert.h>
+
+// Dellacherie's transition and well weights, as tuned in El-Tetris, with height and bumpiness added at small weights
+const EvalWeights EVAL_WEIGHTS_DEFAULT = {
+    .aggregate_height = -0.51f,
+    .holes = -7.90f,
+    .bumpiness = -0.18f,
+    .row_transitions = -3.22f,
+    .col_transitions = -9.35f,
+    .well_depths = -3.39f,
+    .lines = 3.42f,
+};
+
+static inline uint64_t _Eval_row(TetrominoWell const *const w, size_t const row) {
+  WellWord const *const bits = &w->bits[row * w->words];
+  uint64_t filled = bits[0];
+  if (w->words > 1) {
+    filled |= (uint64_t)bits[1] << WELL_WORD_BITS;
+  }
+  return filled;
+}
+
+/**
+ * Extracts board features one row word at a time, top to bottom.
+ *
+ * Everything is derived from the row bitboard and a running cover, the OR of all rows so far, so that a set bit in the
+ * cover means the column's top is at or above the current row. No per-cell loop is needed:
+ * - aggregate height adds up, per row, the columns already topped
+ * - holes are covered cells that are empty
+ * - bumpiness counts, per row, neighbouring columns where only one is topped
+ * - row transitions XOR the row, walled in on both sides, with itself shifted by one
+ * - column transitions XOR each row with the one above, with empty sky above and a solid floor below
+ * - well depths sum 1 + 2 + ... + d over every well d deep, well cells being open cells with filled cells or walls on
+ *   both sides; only these few cells are visited, each one a level deeper than the well cell above it
+ *
+ * @param w Well, at most EVAL_MAX_COLS wide
+ * @return Features with lines left at 0
+ */
+EvalFeatures TetrominoWell_features(TetrominoWell const *const w) {
+  assert(w->cols <= EVAL_MAX_COLS && "well too wide for the evaluator");
+
+  uint64_t const full = (1ULL << w->cols) - 1;
+  uint64_t const left_wall = 1;
+  uint64_t const right_wall = 1ULL << (w->cols - 1);
+  uint64_t const walls = 1 | (1ULL << (w->cols + 1));
+
+  EvalFeatures f = {0};
+  uint64_t cover = 0, above = 0, wells = 0;
+  int32_t depth[EVAL_MAX_COLS];
+
+  for (size_t r = 0; r < w->rows; r++) {
+    uint64_t const row = _Eval_row(w, r);
+    cover |= row;
+
+    f.aggregate_height += __builtin_popcountll(cover);
+    f.holes += __builtin_popcountll(cover & ~row);
+    f.bumpiness += __builtin_popcountll((cover ^ (cover >> 1)) & (full >> 1));
+
+    uint64_t const walled = (row << 1) | walls;
+    f.row_transitions += __builtin_popcountll((walled ^ (walled >> 1)) & ((full << 1) | 1));
+    f.col_transitions += __builtin_popcountll(row ^ above);
+    above = row;
+
+    uint64_t const well = ~cover & ((row << 1) | left_wall) & ((row >> 1) | right_wall) & full;
+    for (uint64_t cells = well; cells != 0; cells &= cells - 1) {
+      int const col = __builtin_ctzll(cells);
+      depth[col] = (wells >> col) & 1 ? depth[col] + 1 : 1;
+      f.well_depths += depth[col];
+    }
+    wells = well;
+  }
+  f.col_transitions += __builtin_popcountll(above ^ full);
+
+  return f;
+}
+
+float Eval_score(EvalWeights const *const weights, EvalFeatures const *const f) {
+  return weights->aggregate_height * (float)f->aggregate_height + weights->holes * (float)f->holes +
+         weights->bumpiness * (float)f->bumpiness + weights->row_transitions * (float)f->row_transitions +
+         weights->col_transitions * (float)f->col_transitions + weights->well_depths * (float)f->well_depths +
+         weights->lines * (float)f->lines;
+}
+
+/**
+ * @param weights Feature weights, EVAL_WEIGHTS_DEFAULT when unsure
+ * @return Score of the well, higher is better
+ */
+float TetrominoWell_eval(TetrominoWell const *const w, EvalWeights const *const weights) {
+  EvalFeatures const f = TetrominoWell_features(w);
+  return Eval_score(weights, &f);
+}
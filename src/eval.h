@@ -0,0 +1,37 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "game.h"
+#include <stdint.h>
+
+// Rows are widened to 64 bits with a wall bit on either side
+#define EVAL_MAX_COLS 62
+
+typedef struct {
+  int32_t aggregate_height;
+  int32_t holes;
+  int32_t bumpiness;
+  int32_t row_transitions;
+  int32_t col_transitions;
+  int32_t well_depths;
+  // Not a property of the well, filled in by whoever placed the piece
+  int32_t lines;
+} EvalFeatures;
+
+typedef struct {
+  float aggregate_height;
+  float holes;
+  float bumpiness;
+  float row_transitions;
+  float col_transitions;
+  float well_depths;
+  float lines;
+} EvalWeights;
+
+extern const EvalWeights EVAL_WEIGHTS_DEFAULT;
+
+EvalFeatures TetrominoWell_features(TetrominoWell const *const w);
+float Eval_score(EvalWeights const *const weights, EvalFeatures const *const f);
+float TetrominoWell_eval(TetrominoWell const *const w, EvalWeights const *const weights);
+
+#endif
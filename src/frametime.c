@@ -0,0 +1,107 @@
+#include "frametime.h"
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+char const *const FRAME_PHASE_NAMES[FRAME_PHASE_CNT] = {
+    [FRAME_PHASE_INPUT] = "input",
+    [FRAME_PHASE_SIM] = "sim",
+    [FRAME_PHASE_RENDER] = "render",
+    [FRAME_PHASE_PRESENT] = "present",
+};
+
+uint64_t FrameTimes_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Phases can be timed in several pieces per frame, e.g. one per input event
+void FrameTimes_add(FrameTimes *const times, EFramePhase const phase, uint64_t const ns) {
+  assert(phase < FRAME_PHASE_CNT && "unknown frame phase");
+  times->current[phase] += ns;
+}
+
+/**
+ * Publishes the frame in progress and starts the next one. Only the render thread may call this.
+ */
+void FrameTimes_commit(FrameTimes *const times) {
+  uint64_t const frame = atomic_load_explicit(&times->frames, memory_order_relaxed);
+  _Atomic uint32_t *const slot = times->ring[frame & (FRAME_TIMES_CAP - 1)];
+
+  for (size_t p = 0; p < FRAME_PHASE_CNT; p++) {
+    uint64_t const ns = times->current[p];
+    atomic_store_explicit(&slot[p], ns < UINT32_MAX ? (uint32_t)ns : UINT32_MAX, memory_order_relaxed);
+  }
+
+  memset(times->current, 0, sizeof(times->current));
+  atomic_store_explicit(&times->frames, frame + 1, memory_order_release);
+}
+
+/**
+ * Min, average, 99th percentile and max of a phase over the published frames, at most FRAME_TIMES_CAP of them.
+ */
+FrameStats FrameTimes_stats(FrameTimes const *const times, EFramePhase const phase) {
+  assert(phase < FRAME_PHASE_CNT && "unknown frame phase");
+
+  uint64_t const frames = atomic_load_explicit(&times->frames, memory_order_acquire);
+  size_t const cnt = frames < FRAME_TIMES_CAP ? (size_t)frames : FRAME_TIMES_CAP;
+  FrameStats stats = {.min = cnt > 0 ? UINT32_MAX : 0, .frames = cnt};
+
+  // The ring is small enough to rank exactly rather than bucket into a histogram
+  uint32_t ns[FRAME_TIMES_CAP];
+  uint64_t sum = 0;
+  for (size_t i = 0; i < cnt; i++) {
+    ns[i] = atomic_load_explicit(&times->ring[i][phase], memory_order_relaxed);
+    sum += ns[i];
+    stats.min = ns[i] < stats.min ? ns[i] : stats.min;
+    stats.max = ns[i] > stats.max ? ns[i] : stats.max;
+  }
+  if (cnt == 0) {
+    return stats;
+  }
+  stats.avg = (uint32_t)(sum / cnt);
+
+  // Selects the element with 99% of the samples at or below it
+  size_t const rank = (cnt * 99 + 99) / 100 - 1;
+  size_t lo = 0, hi = cnt - 1;
+  while (lo < hi) {
+    uint32_t const pivot = ns[(lo + hi) / 2];
+    size_t i = lo, j = hi;
+    while (i <= j) {
+      while (ns[i] < pivot) {
+        i++;
+      }
+      while (ns[j] > pivot) {
+        j--;
+      }
+      if (i <= j) {
+        uint32_t const tmp = ns[i];
+        ns[i++] = ns[j];
+        ns[j] = tmp;
+        if (j == 0) {
+          break;
+        }
+        j--;
+      }
+    }
+    if (rank <= j) {
+      hi = j;
+    } else if (rank >= i) {
+      lo = i;
+    } else {
+      break;
+    }
+  }
+  stats.p99 = ns[rank];
+
+  return stats;
+}
+
+FrameTimer FrameTimer_begin(FrameTimes *const times, EFramePhase const phase) {
+  return (FrameTimer){times, phase, FrameTimes_now()};
+}
+
+void FrameTimer_end(FrameTimer const *const timer) {
+  FrameTimes_add(timer->times, timer->phase, FrameTimes_now() - timer->start_ns);
+}
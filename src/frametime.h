@@ -0,0 +1,52 @@
+#ifndef FRAMETIME_H
+#define FRAMETIME_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Frames kept for the statistics, a power of two
+#define FRAME_TIMES_CAP 256
+
+typedef enum {
+  FRAME_PHASE_INPUT,
+  FRAME_PHASE_SIM,
+  FRAME_PHASE_RENDER,
+  FRAME_PHASE_PRESENT,
+  FRAME_PHASE_CNT,
+} EFramePhase;
+
+extern char const *const FRAME_PHASE_NAMES[FRAME_PHASE_CNT];
+
+// Phase durations of the last FRAME_TIMES_CAP frames. The render thread is the only writer, it sums the phases of
+// the frame in progress into current and publishes them into the ring on commit. Readers on any thread take the
+// published frames without locking, a reader lapped by the writer sees a mix of old and new frames, never a torn
+// value.
+typedef struct {
+  _Atomic uint32_t ring[FRAME_TIMES_CAP][FRAME_PHASE_CNT];
+  _Atomic uint64_t frames;
+  uint64_t current[FRAME_PHASE_CNT];
+} FrameTimes;
+
+// Started by FrameTimer_begin, adds its elapsed time to its phase when ended
+typedef struct {
+  FrameTimes *times;
+  EFramePhase phase;
+  uint64_t start_ns;
+} FrameTimer;
+
+typedef struct {
+  // Nanoseconds over the frames sampled
+  uint32_t min, avg, p99, max;
+  size_t frames;
+} FrameStats;
+
+uint64_t FrameTimes_now(void);
+void FrameTimes_add(FrameTimes *const times, EFramePhase const phase, uint64_t const ns);
+void FrameTimes_commit(FrameTimes *const times);
+FrameStats FrameTimes_stats(FrameTimes const *const times, EFramePhase const phase);
+
+FrameTimer FrameTimer_begin(FrameTimes *const times, EFramePhase const phase);
+void FrameTimer_end(FrameTimer const *const timer);
+
+#endif
@@ -1,120 +1,242 @@
 #include "game.h"
+#include "trace.h"
 #include <assert.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
-static const size_t TETROMINO_COORDS_I[MINO_COORDS_SIZE] = {1, 0, 1, 1, 1, 2, 1, 3};
-static const size_t TETROMINO_COORDS_J[MINO_COORDS_SIZE] = {0, 0, 1, 0, 1, 1, 1, 2};
-static const size_t TETROMINO_COORDS_L[MINO_COORDS_SIZE] = {0, 2, 1, 0, 1, 1, 1, 2};
-static const size_t TETROMINO_COORDS_O[MINO_COORDS_SIZE] = {0, 0, 0, 1, 1, 0, 1, 1};
-static const size_t TETROMINO_COORDS_S[MINO_COORDS_SIZE] = {0, 1, 0, 2, 1, 0, 1, 1};
-static const size_t TETROMINO_COORDS_T[MINO_COORDS_SIZE] = {0, 1, 1, 0, 1, 1, 1, 2};
-static const size_t TETROMINO_COORDS_Z[MINO_COORDS_SIZE] = {0, 0, 0, 1, 1, 1, 1, 2};
-
-Tetromino *Tetromino_init(ETetrominoShape const shape, size_t const row, size_t const col) {
-  Tetromino *new = calloc(1, sizeof(Tetromino));
-  new->shape = shape;
-  new->deg = 0;
-  new->mino_mask = 0;
-  memset(new->mino_shift, 0, sizeof(size_t) * MINO_COORDS_SIZE);
+_Static_assert(BAG_SIZE == TETROMINO_SHAPE_CNT, "a bag holds every shape once");
+
+// Generated by applying the a[i,j] rotation formulas to each spawn orientation, see test_rotation_table.
+const TetrominoRotation TETROMINO_ROTATIONS[TETROMINO_SHAPE_CNT][TETROMINO_ROTATION_CNT] = {
+    [TETROMINO_SHAPE_I] = {
+        {.minos = {0x10, 0x11, 0x12, 0x13}, .rows = {0x0, 0xF, 0x0, 0x0}, .left = 0, .right = 3},
+        {.minos = {0x02, 0x12, 0x22, 0x32}, .rows = {0x4, 0x4, 0x4, 0x4}, .left = 2, .right = 2},
+        {.minos = {0x23, 0x22, 0x21, 0x20}, .rows = {0x0, 0x0, 0xF, 0x0}, .left = 0, .right = 3},
+        {.minos = {0x31, 0x21, 0x11, 0x01}, .rows = {0x2, 0x2, 0x2, 0x2}, .left = 1, .right = 1},
+    },
+    [TETROMINO_SHAPE_J] = {
+        {.minos = {0x00, 0x10, 0x11, 0x12}, .rows = {0x1, 0x7, 0x0, 0x0}, .left = 0, .right = 2},
+        {.minos = {0x02, 0x01, 0x11, 0x21}, .rows = {0x6, 0x2, 0x2, 0x0}, .left = 1, .right = 2},
+        {.minos = {0x22, 0x12, 0x11, 0x10}, .rows = {0x0, 0x7, 0x4, 0x0}, .left = 0, .right = 2},
+        {.minos = {0x20, 0x21, 0x11, 0x01}, .rows = {0x2, 0x2, 0x3, 0x0}, .left = 0, .right = 1},
+    },
+    [TETROMINO_SHAPE_L] = {
+        {.minos = {0x02, 0x10, 0x11, 0x12}, .rows = {0x4, 0x7, 0x0, 0x0}, .left = 0, .right = 2},
+        {.minos = {0x22, 0x01, 0x11, 0x21}, .rows = {0x2, 0x2, 0x6, 0x0}, .left = 1, .right = 2},
+        {.minos = {0x20, 0x12, 0x11, 0x10}, .rows = {0x0, 0x7, 0x1, 0x0}, .left = 0, .right = 2},
+        {.minos = {0x00, 0x21, 0x11, 0x01}, .rows = {0x3, 0x2, 0x2, 0x0}, .left = 0, .right = 1},
+    },
+    [TETROMINO_SHAPE_O] = {
+        {.minos = {0x00, 0x01, 0x10, 0x11}, .rows = {0x3, 0x3, 0x0, 0x0}, .left = 0, .right = 1},
+        {.minos = {0x01, 0x11, 0x00, 0x10}, .rows = {0x3, 0x3, 0x0, 0x0}, .left = 0, .right = 1},
+        {.minos = {0x11, 0x10, 0x01, 0x00}, .rows = {0x3, 0x3, 0x0, 0x0}, .left = 0, .right = 1},
+        {.minos = {0x10, 0x00, 0x11, 0x01}, .rows = {0x3, 0x3, 0x0, 0x0}, .left = 0, .right = 1},
+    },
+    [TETROMINO_SHAPE_S] = {
+        {.minos = {0x01, 0x02, 0x10, 0x11}, .rows = {0x6, 0x3, 0x0, 0x0}, .left = 0, .right = 2},
+        {.minos = {0x12, 0x22, 0x01, 0x11}, .rows = {0x2, 0x6, 0x4, 0x0}, .left = 1, .right = 2},
+        {.minos = {0x21, 0x20, 0x12, 0x11}, .rows = {0x0, 0x6, 0x3, 0x0}, .left = 0, .right = 2},
+        {.minos = {0x10, 0x00, 0x21, 0x11}, .rows = {0x1, 0x3, 0x2, 0x0}, .left = 0, .right = 1},
+    },
+    [TETROMINO_SHAPE_T] = {
+        {.minos = {0x01, 0x10, 0x11, 0x12}, .rows = {0x2, 0x7, 0x0, 0x0}, .left = 0, .right = 2},
+        {.minos = {0x12, 0x01, 0x11, 0x21}, .rows = {0x2, 0x6, 0x2, 0x0}, .left = 1, .right = 2},
+        {.minos = {0x21, 0x12, 0x11, 0x10}, .rows = {0x0, 0x7, 0x2, 0x0}, .left = 0, .right = 2},
+        {.minos = {0x10, 0x21, 0x11, 0x01}, .rows = {0x2, 0x3, 0x2, 0x0}, .left = 0, .right = 1},
+    },
+    [TETROMINO_SHAPE_Z] = {
+        {.minos = {0x00, 0x01, 0x11, 0x12}, .rows = {0x3, 0x6, 0x0, 0x0}, .left = 0, .right = 2},
+        {.minos = {0x02, 0x12, 0x11, 0x21}, .rows = {0x4, 0x6, 0x2, 0x0}, .left = 1, .right = 2},
+        {.minos = {0x22, 0x21, 0x11, 0x10}, .rows = {0x0, 0x3, 0x6, 0x0}, .left = 0, .right = 2},
+        {.minos = {0x20, 0x10, 0x11, 0x01}, .rows = {0x2, 0x3, 0x1, 0x0}, .left = 0, .right = 1},
+    },
+};
+
+// Distinct streams of Zobrist keys, fixed so hashes stay comparable across runs and machines
+#define ZOBRIST_CELL_SEED 0x5A0B0C1D2E3F4051ULL
+#define ZOBRIST_PIECE_SEED 0x1F2E3D4C5B6A7988ULL
+#define ZOBRIST_QUEUE_SEED 0x7B1D3E5F9A2C4E60ULL
+
+// splitmix64 finalizer, keys are derived on the fly instead of living in tables
+static inline uint64_t _Zobrist_mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+static inline uint64_t _Zobrist_rotl(uint64_t const x, size_t const r) {
+  size_t const k = r % 64;
+  return k == 0 ? x : (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t _Zobrist_col(size_t const col) { return _Zobrist_mix(ZOBRIST_CELL_SEED + col); }
+
+// Zeroed like calloc, but starting on a cache line and filling whole lines, so games stepped by different threads
+// never share a line
+static void *_Game_calloc(size_t const cnt, size_t const size) {
+  size_t const bytes = cnt * size > 0 ? (cnt * size + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1)
+                                      : CACHE_LINE_SIZE;
+  void *new = aligned_alloc(CACHE_LINE_SIZE, bytes);
+  assert(new != NULL && "game allocation failed");
+  memset(new, 0, bytes);
+
+  return new;
+}
+
+// aligned_alloc has no realloc counterpart, growing copies into fresh lines
+static void *_Game_realloc(void *const old, size_t const old_bytes, size_t const bytes) {
+  void *new = _Game_calloc(1, bytes);
+  memcpy(new, old, old_bytes < bytes ? old_bytes : bytes);
+  free(old);
+
+  return new;
+}
+
+TetrominoPool *TetrominoPool_init(size_t const cap) {
+  TetrominoPool *new = _Game_calloc(1, sizeof(TetrominoPool));
+  new->slots = _Game_calloc(cap, sizeof(TetrominoSlot));
+  new->free_list = NULL;
+  new->cap = cap;
+  new->used = 0;
+
+  return new;
+}
+
+void TetrominoPool_free(TetrominoPool *pool) {
+  if (pool == NULL) {
+    return;
+  }
+
+  free(pool->slots);
+  free(pool);
+}
+
+void TetrominoPool_reset(TetrominoPool *const pool) {
+  // Slots are re-initialised on acquisition, so forgetting about them is enough
+  pool->free_list = NULL;
+  pool->used = 0;
+}
+
+Tetromino *Tetromino_init(TetrominoPool *const pool, ETetrominoShape const shape, size_t const row, size_t const col) {
+  TetrominoSlot *slot = NULL;
+
+  if (pool->free_list != NULL) {
+    slot = pool->free_list;
+    pool->free_list = slot->next;
+  } else if (pool->used < pool->cap) {
+    slot = &pool->slots[pool->used++];
+  } else {
+    assert(false && "TetrominoPool exhausted");
+    return NULL;
+  }
+
+  Tetromino *new = &slot->t;
+  *new = (Tetromino){.shape = shape, .deg = 0, .mino_mask = 0};
 
   switch (shape) {
   case TETROMINO_SHAPE_I:
     new->row0 = row - 1;
     new->col0 = col;
-    new->mino_coords = TETROMINO_COORDS_I;
     new->bound_size = 4;
     break;
   case TETROMINO_SHAPE_J:
     new->row0 = row;
     new->col0 = col;
-    new->mino_coords = TETROMINO_COORDS_J;
     new->bound_size = 3;
     break;
   case TETROMINO_SHAPE_L:
     new->row0 = row;
     new->col0 = col - 2;
-    new->mino_coords = TETROMINO_COORDS_L;
     new->bound_size = 3;
     break;
   case TETROMINO_SHAPE_O:
     new->row0 = row;
     new->col0 = col;
-    new->mino_coords = TETROMINO_COORDS_O;
     new->bound_size = 2;
     break;
   case TETROMINO_SHAPE_S:
     new->row0 = row;
     new->col0 = col - 1;
-    new->mino_coords = TETROMINO_COORDS_S;
     new->bound_size = 3;
     break;
   case TETROMINO_SHAPE_T:
     new->row0 = row;
     new->col0 = col - 1;
-    new->mino_coords = TETROMINO_COORDS_T;
     new->bound_size = 3;
     break;
   case TETROMINO_SHAPE_Z:
     new->row0 = row;
     new->col0 = col;
-    new->mino_coords = TETROMINO_COORDS_Z;
     new->bound_size = 3;
     break;
+  case TETROMINO_SHAPE_CNT:
+    assert(false && "invalid tetromino shape");
+    break;
   }
 
   return new;
 }
 
-static size_t *_Tetromino_rotated_coords(Tetromino const *const t) {
-  assert(t->deg == 0 || t->deg == 90 || t->deg == 180 || t->deg == 270 && "invalid tetromino rotation");
+TetrominoRotation const *Tetromino_rotation(Tetromino const *const t) {
+  assert(t->deg % 90 == 0 && t->deg < 360 && "invalid tetromino rotation");
 
-  size_t *arr = calloc(1, sizeof(size_t) * MINO_COORDS_SIZE);
+  return &TETROMINO_ROTATIONS[t->shape][t->deg / 90];
+}
 
-  if (t->deg == 0) {
-    for (size_t e = 0; e < MINO_COORDS_SIZE; e += 2) {
-      arr[e] = t->mino_coords[e];
-      arr[e + 1] = t->mino_coords[e + 1];
-    }
-  } else if (t->deg == 90) {
-    for (size_t e = 0; e < MINO_COORDS_SIZE; e = e + 2) {
-      // Rotating pi radians: a[i,j] = a[j][n-i-1]
-      arr[e] = t->mino_coords[e + 1];
-      arr[e + 1] = t->bound_size - t->mino_coords[e] - 1;
-    }
-  } else if (t->deg == 180) {
-    for (size_t e = 0; e < MINO_COORDS_SIZE; e = e + 2) {
-      // Rotating 2pi radians: a[i,j] = a[n-i-1][n-j-1]
-      arr[e] = t->bound_size - t->mino_coords[e] - 1;
-      arr[e + 1] = t->bound_size - t->mino_coords[e + 1] - 1;
-    }
-  } else if (t->deg == 270) {
-    for (size_t e = 0; e < MINO_COORDS_SIZE; e = e + 2) {
-      // Rotating 3pi radians: a[i,j] = a[n-j-1][i]
-      arr[e] = t->bound_size - t->mino_coords[e + 1] - 1;
-      arr[e + 1] = t->mino_coords[e];
+/**
+ * Zobrist key of the piece's pose, XOR it out and back in around a move to keep a position hash current.
+ */
+uint64_t Tetromino_hash(Tetromino const *const t) {
+  uint64_t const pose = (uint64_t)t->shape | (uint64_t)(t->deg / 90) << 3 | (uint64_t)(t->row0 & 0xFF) << 5 |
+                        (uint64_t)(t->col0 & 0xFF) << 13;
+  return _Zobrist_mix(ZOBRIST_PIECE_SEED ^ pose);
+}
+
+void Tetromino_translate(Tetromino *const t, size_t const row_shift, size_t const col_shift) {
+  t->row0 += row_shift;
+  t->col0 += col_shift;
+}
+
+void Tetromino_rotate(Tetromino *const t, uint32_t const deg) {
+  assert(deg % 90 == 0 && "invalid tetromino rotation");
+
+  t->deg = (t->deg + deg) % 360;
+}
+
+void Tetromino_hide_mino(Tetromino *const t, uint8_t const row) {
+  MinoCoords const c = TetrominoWell_coords(t);
+
+  for (size_t i = 0; i < MINO_COORDS_SIZE; i += 2) {
+    if (c.coords[i] == row) {
+      // We determine whether a mino block is hidden by setting the 0 - 3 bit
+      t->mino_mask |= (uint8_t)(1 << i / 2);
     }
-  } else {
-    assert(false && "invalid termino rotation");
   }
-
-  return arr;
 }
 
-void Tetromino_free(Tetromino *t) {
+void Tetromino_free(TetrominoPool *const pool, Tetromino *t) {
   if (t == NULL) {
     return;
   }
 
-  free(t);
+  assert((TetrominoSlot *)t >= pool->slots && (TetrominoSlot *)t < pool->slots + pool->used &&
+         "tetromino does not belong to pool");
+
+  TetrominoSlot *slot = (TetrominoSlot *)t;
+  slot->next = pool->free_list;
+  pool->free_list = slot;
 }
 
 TetrominoCollection *TetrominoCollection_init(size_t const cap) {
-  TetrominoCollection *new = calloc(1, sizeof(TetrominoCollection));
-  new->arr = calloc(1, sizeof(Tetromino) * 100);
-  new->cap = cap;
+  TetrominoCollection *new = _Game_calloc(1, sizeof(TetrominoCollection));
+  new->cap = cap > 0 ? cap : 1;
   new->cnt = 0;
+  new->shape = _Game_calloc(new->cap, sizeof(*new->shape));
+  new->rotation = _Game_calloc(new->cap, sizeof(*new->rotation));
+  new->row0 = _Game_calloc(new->cap, sizeof(*new->row0));
+  new->col0 = _Game_calloc(new->cap, sizeof(*new->col0));
+  new->mino_row = _Game_calloc(new->cap, sizeof(*new->mino_row));
 
   return new;
 }
@@ -124,35 +246,671 @@ void TetrominoCollection_free(TetrominoCollection *coll) {
     return;
   }
 
-  for (size_t i = 0; i < coll->cnt; i++) {
-    Tetromino_free(coll->arr[i]);
-  }
-
-  free(coll->arr);
+  free(coll->shape);
+  free(coll->rotation);
+  free(coll->row0);
+  free(coll->col0);
+  free(coll->mino_row);
   free(coll);
 }
 
-void TetrominoCollection_push(TetrominoCollection *const coll, Tetromino *const t) {
+void TetrominoCollection_push(TetrominoCollection *const coll, Tetromino const *const t) {
   if (coll->cnt + 1 > coll->cap) {
-    // TODO: resize and add
     TetrominoCollection_resize(coll);
-    assert(false && "resize TetrominoCollection not implemented");
-    return;
   }
 
-  coll->arr[coll->cnt++] = t;
+  size_t const i = coll->cnt++;
+  coll->shape[i] = (uint8_t)t->shape;
+  coll->rotation[i] = (uint8_t)(t->deg / 90);
+  coll->row0[i] = t->row0;
+  coll->col0[i] = t->col0;
 }
 
 void TetrominoCollection_resize(TetrominoCollection *const coll) {
-  assert(false && "resize TetrominoCollection not implemented");
+  // Doubling keeps pushes amortised O(1) however long the game runs
+  size_t const cap = coll->cap * 2;
+
+  coll->shape = _Game_realloc(coll->shape, coll->cap * sizeof(*coll->shape), cap * sizeof(*coll->shape));
+  coll->rotation = _Game_realloc(coll->rotation, coll->cap * sizeof(*coll->rotation), cap * sizeof(*coll->rotation));
+  coll->row0 = _Game_realloc(coll->row0, coll->cap * sizeof(*coll->row0), cap * sizeof(*coll->row0));
+  coll->col0 = _Game_realloc(coll->col0, coll->cap * sizeof(*coll->col0), cap * sizeof(*coll->col0));
+  coll->mino_row = _Game_realloc(coll->mino_row, coll->cap * sizeof(*coll->mino_row), cap * sizeof(*coll->mino_row));
+
+  coll->cap = cap;
+}
+
+Tetromino TetrominoCollection_get(TetrominoCollection const *const coll, size_t const idx) {
+  assert(idx < coll->cnt && "TetrominoCollection index out of bounds");
+
+  return (Tetromino){
+      .row0 = coll->row0[idx],
+      .col0 = coll->col0[idx],
+      .deg = coll->rotation[idx] * 90u,
+      .shape = coll->shape[idx],
+  };
 }
 
-size_t *TetrominoWell_coords(Tetromino const *const t) {
-  size_t *coords = _Tetromino_rotated_coords(t);
+MinoCoords TetrominoWell_coords(Tetromino const *const t) {
+  uint8_t const *const minos = Tetromino_rotation(t)->minos;
+  MinoCoords out;
 
   for (size_t i = 0; i < MINO_COORDS_SIZE; i += 2) {
-    coords[i] = t->row0 + t->mino_shift[i];
-    coords[i + 1] = t->col0 + t->mino_shift[i + 1];
+    out.coords[i] = MINO_ROW(minos[i / 2]) + t->row0;
+    out.coords[i + 1] = MINO_COL(minos[i / 2]) + t->col0;
+  }
+
+  return out;
+}
+
+static inline WellWord *_TetrominoWell_row(TetrominoWell const *const w, size_t const row) {
+  return &w->bits[row * w->words];
+}
+
+TetrominoWell *TetrominoWell_init(size_t const rows, size_t const cols) {
+  assert(rows > 0 && cols > 0 && "well must have at least one cell");
+  assert(cols <= UINT16_MAX && "row fill counts are 16 bit");
+
+  TetrominoWell *new = _Game_calloc(1, sizeof(TetrominoWell));
+  new->rows = rows;
+  new->cols = cols;
+  new->words = (cols + WELL_WORD_BITS - 1) / WELL_WORD_BITS;
+  new->bits = _Game_calloc(rows * new->words, sizeof(WellWord));
+  new->full = _Game_calloc(new->words, sizeof(WellWord));
+  new->fill = _Game_calloc(rows, sizeof(uint16_t));
+  new->full_rows = _Game_calloc((rows + 63) / 64, sizeof(uint64_t));
+  new->full_cnt = 0;
+  new->row_id = _Game_calloc(rows, sizeof(uint32_t));
+  new->next_row_id = (uint32_t)rows;
+  new->row_hash = _Game_calloc(rows, sizeof(uint64_t));
+  new->hash = 0;
+  new->pool = TetrominoPool_init(TETROMINO_POOL_CAP);
+  new->coll = TetrominoCollection_init(100);
+
+  for (size_t i = 0; i < new->words; i++) {
+    size_t const remaining = cols - i * WELL_WORD_BITS;
+    new->full[i] = remaining >= WELL_WORD_BITS ? (WellWord)~0 : ((WellWord)1 << remaining) - 1;
+  }
+
+  for (size_t row = 0; row < rows; row++) {
+    new->row_id[row] = (uint32_t)(rows - row - 1);
+  }
+
+  return new;
+}
+
+void TetrominoWell_free(TetrominoWell *w) {
+  if (w == NULL) {
+    return;
+  }
+
+  TetrominoCollection_free(w->coll);
+  TetrominoPool_free(w->pool);
+  free(w->bits);
+  free(w->full);
+  free(w->fill);
+  free(w->full_rows);
+  free(w->row_id);
+  free(w->row_hash);
+  free(w);
+}
+
+void TetrominoWell_reset(TetrominoWell *const w) {
+  memset(w->bits, 0, sizeof(WellWord) * w->rows * w->words);
+  memset(w->fill, 0, sizeof(uint16_t) * w->rows);
+  memset(w->full_rows, 0, sizeof(uint64_t) * ((w->rows + 63) / 64));
+  w->full_cnt = 0;
+  for (size_t row = 0; row < w->rows; row++) {
+    w->row_id[row] = (uint32_t)(w->rows - row - 1);
+  }
+  w->next_row_id = (uint32_t)w->rows;
+  memset(w->row_hash, 0, sizeof(uint64_t) * w->rows);
+  w->hash = 0;
+  TetrominoPool_reset(w->pool);
+  w->coll->cnt = 0;
+}
+
+/**
+ * Copies the occupancy of src, locked pieces are not copied and dst's are dropped.
+ *
+ * @param dst Well of the same size as src
+ */
+void TetrominoWell_copy(TetrominoWell *const dst, TetrominoWell const *const src) {
+  assert(dst->rows == src->rows && dst->cols == src->cols && "wells must be the same size");
+
+  memcpy(dst->bits, src->bits, sizeof(WellWord) * src->rows * src->words);
+  memcpy(dst->fill, src->fill, sizeof(uint16_t) * src->rows);
+  memcpy(dst->full_rows, src->full_rows, sizeof(uint64_t) * ((src->rows + 63) / 64));
+  memcpy(dst->row_id, src->row_id, sizeof(uint32_t) * src->rows);
+  memcpy(dst->row_hash, src->row_hash, sizeof(uint64_t) * src->rows);
+  dst->full_cnt = src->full_cnt;
+  dst->next_row_id = src->next_row_id;
+  dst->hash = src->hash;
+  dst->coll->cnt = 0;
+}
+
+bool TetrominoWell_occupied(TetrominoWell const *const w, size_t const row, size_t const col) {
+  assert(row < w->rows && col < w->cols && "well cell out of bounds");
+
+  return (_TetrominoWell_row(w, row)[col / WELL_WORD_BITS] >> (col % WELL_WORD_BITS)) & 1;
+}
+
+static inline void _TetrominoWell_count(TetrominoWell *const w, size_t const row, size_t const cnt) {
+  w->fill[row] += (uint16_t)cnt;
+
+  if (w->fill[row] == w->cols) {
+    w->full_rows[row / 64] |= 1ULL << (row % 64);
+    w->full_cnt++;
+  }
+}
+
+void TetrominoWell_fill(TetrominoWell *const w, size_t const row, size_t const col) {
+  if (TetrominoWell_occupied(w, row, col)) {
+    return;
+  }
+
+  _TetrominoWell_row(w, row)[col / WELL_WORD_BITS] |= (WellWord)1 << (col % WELL_WORD_BITS);
+  _TetrominoWell_count(w, row, 1);
+  w->row_hash[row] ^= _Zobrist_col(col);
+  w->hash ^= _Zobrist_rotl(_Zobrist_col(col), row);
+}
+
+bool TetrominoWell_collision(TetrominoWell const *const w, Tetromino const *const t, size_t const row_shift,
+                             size_t const col_shift) {
+  TetrominoRotation const *const rot = Tetromino_rotation(t);
+  size_t const col = t->col0 + col_shift;
+
+  // Shifts are applied modulo SIZE_MAX, so anything left of or above the well wraps past the far bound and a single
+  // comparison per axis covers both walls.
+  if (col + rot->left >= w->cols || col + rot->right >= w->cols) {
+    return true;
+  }
+
+  size_t const base = col + rot->left;
+  for (size_t r = 0; r < MINO_CNT; r++) {
+    if (rot->rows[r] == 0) {
+      continue;
+    }
+
+    size_t const row = t->row0 + row_shift + r;
+    if (row >= w->rows) {
+      return true;
+    }
+
+    WellWord const *const bits = &_TetrominoWell_row(w, row)[base / WELL_WORD_BITS];
+    uint64_t const placed = (uint64_t)(rot->rows[r] >> rot->left) << (base % WELL_WORD_BITS);
+    WellWord const spill = (WellWord)(placed >> WELL_WORD_BITS);
+    if ((bits[0] & (WellWord)placed) || (spill && (bits[1] & spill))) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// XOR of the column keys of a box row's minos
+static inline uint64_t _TetrominoWell_row_key(uint8_t const box_row, size_t const col0) {
+  uint64_t key = 0;
+  for (uint8_t m = box_row; m; m &= m - 1) {
+    key ^= _Zobrist_col(col0 + (size_t)__builtin_ctz(m));
+  }
+  return key;
+}
+
+/**
+ * Sets the tetromino's minos in the well without recording the piece, for boards that only need occupancy.
+ */
+void TetrominoWell_place(TetrominoWell *const w, Tetromino const *const t) {
+  assert(!TetrominoWell_collision(w, t, 0, 0) && "locking tetromino outside of the well");
+
+  TetrominoRotation const *const rot = Tetromino_rotation(t);
+  size_t const base = t->col0 + rot->left;
+
+  for (size_t r = 0; r < MINO_CNT; r++) {
+    if (rot->rows[r] == 0) {
+      continue;
+    }
+
+    WellWord *const bits = &_TetrominoWell_row(w, t->row0 + r)[base / WELL_WORD_BITS];
+    uint64_t const placed = (uint64_t)(rot->rows[r] >> rot->left) << (base % WELL_WORD_BITS);
+    WellWord const spill = (WellWord)(placed >> WELL_WORD_BITS);
+    bits[0] |= (WellWord)placed;
+    if (spill) {
+      bits[1] |= spill;
+    }
+
+    _TetrominoWell_count(w, t->row0 + r, (size_t)__builtin_popcount(rot->rows[r]));
+
+    uint64_t const delta = _TetrominoWell_row_key(rot->rows[r], t->col0);
+    w->row_hash[t->row0 + r] ^= delta;
+    w->hash ^= _Zobrist_rotl(delta, t->row0 + r);
+  }
+}
+
+/**
+ * @return Whether placing the tetromino would complete a row
+ */
+bool TetrominoWell_place_clears(TetrominoWell const *const w, Tetromino const *const t) {
+  TetrominoRotation const *const rot = Tetromino_rotation(t);
+  for (size_t r = 0; r < MINO_CNT; r++) {
+    if (rot->rows[r] && w->fill[t->row0 + r] + __builtin_popcount(rot->rows[r]) == (int)w->cols) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Hash the well would have with the tetromino placed, before any rows are cleared, in four XORs and no copy.
+ */
+uint64_t TetrominoWell_place_hash(TetrominoWell const *const w, Tetromino const *const t) {
+  TetrominoRotation const *const rot = Tetromino_rotation(t);
+  uint64_t hash = w->hash;
+  for (size_t r = 0; r < MINO_CNT; r++) {
+    if (rot->rows[r]) {
+      hash ^= _Zobrist_rotl(_TetrominoWell_row_key(rot->rows[r], t->col0), t->row0 + r);
+    }
   }
+  return hash;
+}
+
+void TetrominoWell_lock(TetrominoWell *const w, Tetromino const *const t) {
+  TetrominoWell_place(w, t);
+
+  TetrominoRotation const *const rot = Tetromino_rotation(t);
+  TetrominoCollection *const coll = w->coll;
+  TetrominoCollection_push(coll, t);
+  for (size_t m = 0; m < MINO_CNT; m++) {
+    coll->mino_row[coll->cnt - 1][m] = w->row_id[t->row0 + MINO_ROW(rot->minos[m])];
+  }
+}
+
+static size_t _TetrominoWell_row_of(TetrominoWell const *const w, uint32_t const id) {
+  // row_id is strictly decreasing, so the row still carrying an id can be binary searched for
+  size_t lo = 0, hi = w->rows;
+
+  while (lo < hi) {
+    size_t const mid = lo + (hi - lo) / 2;
+    if (w->row_id[mid] == id) {
+      return mid;
+    } else if (w->row_id[mid] > id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return SIZE_MAX;
+}
+
+/**
+ * Resolves the current coordinates of a locked tetromino from the row ids it locked into.
+ *
+ * @param w Pointer to the TetrominoWell structure
+ * @param idx Index of the tetromino in the well's collection
+ * @param mino_mask Set to a bit per mino whose row has since been cleared
+ * @return Coordinates of the minos, only meaningful for those not in mino_mask
+ */
+MinoCoords TetrominoWell_locked_coords(TetrominoWell const *const w, size_t const idx, uint8_t *const mino_mask) {
+  TetrominoCollection const *const coll = w->coll;
+  assert(idx < coll->cnt && "TetrominoCollection index out of bounds");
+
+  uint8_t const *const minos = TETROMINO_ROTATIONS[coll->shape[idx]][coll->rotation[idx]].minos;
+  MinoCoords out;
+  *mino_mask = 0;
+
+  for (size_t m = 0; m < MINO_CNT; m++) {
+    size_t const row = _TetrominoWell_row_of(w, coll->mino_row[idx][m]);
+    if (row == SIZE_MAX) {
+      *mino_mask |= (uint8_t)(1 << m);
+    }
+
+    out.coords[2 * m] = row;
+    out.coords[2 * m + 1] = coll->col0[idx] + MINO_COL(minos[m]);
+  }
+
+  return out;
+}
+
+bool TetrominoWell_row_full(TetrominoWell const *const w, size_t const row) { return w->fill[row] == w->cols; }
+
+/**
+ * Bit mask indicating which rows in the well are completely filled.
+ *
+ * @param w Pointer to the TetrominoWell structure
+ * @return Bit mask where each bit represents a row (1 = full, 0 = not full)
+ */
+uint64_t TetrominoWell_full_row_mask(TetrominoWell const *const w) {
+  assert(w->rows <= 64 && "full row mask can only track up to 64 rows");
+
+  return w->full_rows[0];
+}
+
+static inline void _TetrominoWell_move_rows(TetrominoWell *const w, size_t const dst, size_t const src,
+                                            size_t const cnt) {
+  memmove(_TetrominoWell_row(w, dst), _TetrominoWell_row(w, src), sizeof(WellWord) * w->words * cnt);
+  memmove(&w->fill[dst], &w->fill[src], sizeof(uint16_t) * cnt);
+  memmove(&w->row_id[dst], &w->row_id[src], sizeof(uint32_t) * cnt);
+  memmove(&w->row_hash[dst], &w->row_hash[src], sizeof(uint64_t) * cnt);
+}
+
+// Forgets the locked tetrominos whose minos were all cleared, so the collection never outgrows what is in the well
+static void _TetrominoWell_drop_cleared(TetrominoWell *const w) {
+  TetrominoCollection *const coll = w->coll;
+  size_t kept = 0;
+
+  for (size_t i = 0; i < coll->cnt; i++) {
+    bool live = false;
+    for (size_t m = 0; m < MINO_CNT && !live; m++) {
+      live = _TetrominoWell_row_of(w, coll->mino_row[i][m]) != SIZE_MAX;
+    }
+    if (!live) {
+      continue;
+    }
+
+    if (kept != i) {
+      coll->shape[kept] = coll->shape[i];
+      coll->rotation[kept] = coll->rotation[i];
+      coll->row0[kept] = coll->row0[i];
+      coll->col0[kept] = coll->col0[i];
+      memcpy(coll->mino_row[kept], coll->mino_row[i], sizeof(coll->mino_row[i]));
+    }
+    kept++;
+  }
+
+  coll->cnt = kept;
+}
+
+/**
+ * Removes every full row from the well, compacting the rows above it downwards.
+ *
+ * Each run of surviving rows is moved with a single memmove, so every row is touched at most once. Locked pieces find
+ * their rows again through row_id, they are only scanned afterwards to drop those with every mino cleared, at most
+ * MINO_CNT row lookups each.
+ *
+ * @param w Pointer to the TetrominoWell structure
+ * @return Number of rows cleared
+ */
+size_t TetrominoWell_clear_full_rows(TetrominoWell *const w) {
+  if (w->full_cnt == 0) {
+    return 0;
+  }
+
+  size_t dst = w->rows;
+  size_t src = w->rows;
+
+  while (src > 0) {
+    if (TetrominoWell_row_full(w, src - 1)) {
+      src--;
+      continue;
+    }
+
+    size_t lo = src - 1;
+    while (lo > 0 && !TetrominoWell_row_full(w, lo - 1)) {
+      lo--;
+    }
+
+    size_t const run = src - lo;
+    if (dst != src) {
+      _TetrominoWell_move_rows(w, dst - run, lo, run);
+    }
+
+    dst -= run;
+    src = lo;
+  }
+
+  // Everything above the last compacted row is now empty and gets fresh ids above every existing one
+  memset(w->bits, 0, sizeof(WellWord) * w->words * dst);
+  memset(w->fill, 0, sizeof(uint16_t) * dst);
+  memset(w->row_hash, 0, sizeof(uint64_t) * dst);
+  for (size_t row = dst; row-- > 0;) {
+    w->row_id[row] = w->next_row_id++;
+  }
+
+  // Moved rows only need their cached XOR rotated to the new row, no cells are rehashed
+  w->hash = 0;
+  for (size_t row = dst; row < w->rows; row++) {
+    w->hash ^= _Zobrist_rotl(w->row_hash[row], row);
+  }
+
+  memset(w->full_rows, 0, sizeof(uint64_t) * ((w->rows + 63) / 64));
+  w->full_cnt = 0;
+  _TetrominoWell_drop_cleared(w);
+
+  return dst;
+}
+
+#define FRAME_CLOCK_TICK 1000000000ULL
+
+void FrameClock_init(FrameClock *const clock, uint64_t const now_ns) {
+  clock->last_ns = now_ns;
+  clock->acc = 0;
+}
+
+/**
+ * Accounts for the time since the previous call.
+ *
+ * @param now_ns Monotonic time in nanoseconds
+ * @return Ticks to step this frame, at most GAME_MAX_CATCHUP_TICKS
+ */
+uint32_t FrameClock_advance(FrameClock *const clock, uint64_t const now_ns) {
+  uint64_t const elapsed = now_ns > clock->last_ns ? now_ns - clock->last_ns : 0;
+  clock->last_ns = now_ns;
+
+  // Clamped before scaling so a long stall can neither overflow nor queue up a burst of ticks
+  uint64_t const cap = (uint64_t)(GAME_MAX_CATCHUP_TICKS + 1) * FRAME_CLOCK_TICK;
+  clock->acc += elapsed < cap / GAME_TICK_RATE ? elapsed * GAME_TICK_RATE : cap;
+
+  uint64_t ticks = clock->acc / FRAME_CLOCK_TICK;
+  clock->acc %= FRAME_CLOCK_TICK;
+  if (ticks > GAME_MAX_CATCHUP_TICKS) {
+    ticks = GAME_MAX_CATCHUP_TICKS;
+  }
+
+  return (uint32_t)ticks;
+}
+
+/**
+ * @return How far into the next tick the clock is, in [0, 1), for interpolating what is drawn
+ */
+float FrameClock_alpha(FrameClock const *const clock) {
+  // Floored to 24 bits first, a plain float division rounds values just short of a tick up to exactly 1
+  return (float)((clock->acc << 24) / FRAME_CLOCK_TICK) / (float)(1 << 24);
+}
 
-  return coords;
+GameState *GameState_init(uint64_t const seed) {
+  GameState *new = _Game_calloc(1, sizeof(GameState));
+  new->well = TetrominoWell_init(WELL_ROWS, WELL_COLS);
+  new->preview = GAME_PREVIEW_CNT;
+  GameState_reset(new, seed);
+
+  return new;
+}
+
+void GameState_reset(GameState *const state, uint64_t const seed) {
+  TetrominoWell_reset(state->well);
+  state->active = NULL;
+  state->tick = 0;
+  PieceBag_init(&state->bag, seed);
+  state->gravity_ticks = GAME_GRAVITY_TICKS;
+  state->gravity_cnt = 0;
+  state->lock_delay = GAME_LOCK_DELAY_TICKS;
+  state->lock_cnt = 0;
+  state->lines = 0;
+  state->pieces = 0;
+  state->status = GAME_STATUS_PLAYING;
+}
+
+void GameState_free(GameState *t) {
+  if (t == NULL) {
+    return;
+  }
+
+  TetrominoWell_free(t->well);
+  free(t);
+}
+
+uint64_t Game_queue_hash(ETetrominoShape const *const shapes, size_t const cnt) {
+  uint64_t hash = 0;
+  for (size_t i = 0; i < cnt; i++) {
+    hash ^= _Zobrist_mix(ZOBRIST_QUEUE_SEED ^ (i << 3 | shapes[i]));
+  }
+  return hash;
+}
+
+/**
+ * Zobrist hash of a position: well occupancy, active piece and the state->preview next pieces. There is no hold piece.
+ */
+uint64_t Game_hash(GameState const *const state) {
+  assert(state->preview <= GAME_HASH_MAX_PREVIEW && "preview too long to hash");
+
+  ETetrominoShape shapes[GAME_HASH_MAX_PREVIEW];
+  Game_preview(state, shapes, state->preview);
+
+  uint64_t hash = state->well->hash ^ Game_queue_hash(shapes, state->preview);
+  if (state->active != NULL) {
+    hash ^= Tetromino_hash(state->active);
+  }
+  return hash;
+}
+
+static ETetrominoShape _Game_next_shape(GameState *const state) { return (ETetrominoShape)PieceBag_next(&state->bag); }
+
+/**
+ * Shapes of the next pieces to spawn, without advancing the game.
+ *
+ * @param shapes Receives cnt shapes, the next one to spawn first
+ * @param cnt At most GAME_HASH_MAX_PREVIEW
+ */
+void Game_preview(GameState const *const state, ETetrominoShape *const shapes, size_t const cnt) {
+  assert(cnt <= GAME_HASH_MAX_PREVIEW && "preview too long");
+
+  uint8_t peek[GAME_HASH_MAX_PREVIEW];
+  PieceBag_peek(&state->bag, peek, cnt);
+  for (size_t i = 0; i < cnt; i++) {
+    shapes[i] = (ETetrominoShape)peek[i];
+  }
+}
+
+static bool _Game_try_move(GameState *const state, size_t const row_shift, size_t const col_shift) {
+  if (TetrominoWell_collision(state->well, state->active, row_shift, col_shift)) {
+    return false;
+  }
+
+  Tetromino_translate(state->active, row_shift, col_shift);
+  return true;
+}
+
+static bool _Game_try_rotate(GameState *const state, uint32_t const deg) {
+  Tetromino_rotate(state->active, deg);
+
+  if (TetrominoWell_collision(state->well, state->active, 0, 0)) {
+    Tetromino_rotate(state->active, 360 - deg);
+    return false;
+  }
+
+  return true;
+}
+
+static void _Game_lock(GameState *const state) {
+  TRACE_BEGIN("lock");
+  TetrominoWell_lock(state->well, state->active);
+  TRACE_ASYNC_END("piece", (int64_t)state->pieces);
+
+  TRACE_BEGIN("line clear");
+  size_t const cleared = TetrominoWell_clear_full_rows(state->well);
+  state->lines += cleared;
+  TRACE_END("line clear");
+  if (cleared > 0) {
+    TRACE_INSTANT("lines", (int64_t)cleared);
+  }
+
+  Tetromino_free(state->well->pool, state->active);
+  state->active = NULL;
+  state->gravity_cnt = 0;
+  state->lock_cnt = 0;
+  TRACE_END("lock");
+}
+
+/**
+ * Advances the game by exactly one tick.
+ *
+ * The same state and input sequence always produce the same game, so the simulation can run headless at any speed.
+ * Inputs are actions taken this tick, repeating held keys is up to the caller.
+ *
+ * @param state Game to advance
+ * @param input Mask of EInput actions, applied rotate, move, then drop
+ * @return Status of the game after the tick
+ */
+EGameStatus Game_step(GameState *const state, InputMask const input) {
+  if (state->status == GAME_STATUS_OVER) {
+    return state->status;
+  }
+
+  state->tick++;
+
+  if (state->active == NULL) {
+    TetrominoWell *const w = state->well;
+    state->active = Tetromino_init(w->pool, _Game_next_shape(state), 0, (w->cols - 1) / 2);
+    state->pieces++;
+    // Spans a piece from spawn to lock
+    TRACE_ASYNC_BEGIN("piece", (int64_t)state->pieces);
+
+    if (TetrominoWell_collision(w, state->active, 0, 0)) {
+      TRACE_INSTANT("game over", (int64_t)state->lines);
+      state->status = GAME_STATUS_OVER;
+      return state->status;
+    }
+  }
+
+  if (input & INPUT_ROTATE_RIGHT) {
+    _Game_try_rotate(state, 90);
+  }
+  if (input & INPUT_ROTATE_LEFT) {
+    _Game_try_rotate(state, 270);
+  }
+  if (input & INPUT_MOVE_LEFT) {
+    _Game_try_move(state, 0, -1);
+  }
+  if (input & INPUT_MOVE_RIGHT) {
+    _Game_try_move(state, 0, 1);
+  }
+
+  if (input & INPUT_HARD_DROP) {
+    while (_Game_try_move(state, 1, 0)) {
+      continue;
+    }
+    _Game_lock(state);
+    return state->status;
+  }
+
+  if ((input & INPUT_SOFT_DROP) || ++state->gravity_cnt >= state->gravity_ticks) {
+    state->gravity_cnt = 0;
+    TRACE_BEGIN("gravity");
+    _Game_try_move(state, 1, 0);
+    TRACE_END("gravity");
+  }
+
+  if (!TetrominoWell_collision(state->well, state->active, 1, 0)) {
+    state->lock_cnt = 0;
+  } else if (++state->lock_cnt >= state->lock_delay) {
+    _Game_lock(state);
+  }
+
+  return state->status;
+}
+
+/**
+ * How far the active piece has fallen towards the row below, so it can be drawn gliding down between gravity ticks
+ * instead of jumping a whole row.
+ *
+ * @param alpha Fraction of the current tick elapsed, see FrameClock_alpha
+ * @return Rows in [0, 1) to draw the active piece below its position, 0 when it rests on the stack
+ */
+float Game_fall_offset(GameState const *const state, float const alpha) {
+  if (state->active == NULL || state->status == GAME_STATUS_OVER ||
+      TetrominoWell_collision(state->well, state->active, 1, 0)) {
+    return 0;
+  }
+
+  return ((float)state->gravity_cnt + alpha) / (float)state->gravity_ticks;
+}
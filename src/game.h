@@ -1,10 +1,30 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include "bag.h"
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #define MINO_COORDS_SIZE 8
+#define MINO_CNT 4
+#define TETROMINO_ROTATION_CNT 4
+#define TETROMINO_POOL_CAP 16
+#define WELL_ROWS 20
+#define WELL_COLS 10
+#define WELL_WORD_BITS 32
+// The simulation advances in fixed ticks, independent of how often it is rendered
+#define GAME_TICK_RATE 60
+// Most ticks one frame may catch up on, a longer stall is dropped instead of fast-forwarded
+#define GAME_MAX_CATCHUP_TICKS 8
+#define GAME_GRAVITY_TICKS 60
+#define GAME_LOCK_DELAY_TICKS 30
+
+#define CACHE_LINE_SIZE 64
+// Longest preview a game may have, and so the most Game_hash folds in
+#define GAME_HASH_MAX_PREVIEW 16
+// Upcoming pieces shown to the player, can be changed per game after GameState_init
+#define GAME_PREVIEW_CNT 5
 
 typedef enum {
   TETROMINO_SHAPE_I,
@@ -14,50 +34,170 @@ typedef enum {
   TETROMINO_SHAPE_S,
   TETROMINO_SHAPE_T,
   TETROMINO_SHAPE_Z,
+  TETROMINO_SHAPE_CNT,
 } ETetrominoShape;
 typedef enum { TETROMINO_STATE_ACTIVE } ETetrominoState;
 
+// Mino offsets within the bounding box are packed as a (row, col) nibble pair
+#define MINO_PACK(row, col) ((uint8_t)(((row) << 4) | (col)))
+#define MINO_ROW(p) ((size_t)((p) >> 4))
+#define MINO_COL(p) ((size_t)((p) & 0xF))
+
+typedef struct {
+  uint8_t minos[MINO_CNT];
+  // Occupied columns of each bounding box row, ready to be shifted into a well row by col0
+  uint8_t rows[MINO_CNT];
+  // Leftmost and rightmost occupied columns of the bounding box
+  uint8_t left, right;
+} TetrominoRotation;
+
+// Absolute well coordinates of a tetromino's minos as interleaved (row, col) pairs
+typedef struct {
+  size_t coords[MINO_COORDS_SIZE];
+} MinoCoords;
+
+extern const TetrominoRotation TETROMINO_ROTATIONS[TETROMINO_SHAPE_CNT][TETROMINO_ROTATION_CNT];
+
 typedef struct {
   size_t row0, col0;
   uint32_t deg;
-  size_t const *mino_coords;
-  size_t mino_shift[MINO_COORDS_SIZE];
   uint8_t mino_mask;
   uint8_t bound_size;
   ETetrominoShape shape;
   ETetrominoState state;
 } Tetromino;
 
+typedef union TetrominoSlot {
+  Tetromino t;
+  union TetrominoSlot *next;
+} TetrominoSlot;
+
+// Fixed-capacity storage for every tetromino of a game, so pieces never touch the heap individually
+typedef struct {
+  TetrominoSlot *slots;
+  // Released slots, reused before any untouched ones
+  TetrominoSlot *free_list;
+  size_t cap, used;
+} TetrominoPool;
+
+// Locked tetrominos stored field by field so passes over the whole collection stream through contiguous memory
 typedef struct {
-  Tetromino **arr;
+  uint8_t *shape;
+  uint8_t *rotation;
+  size_t *row0, *col0;
+  // Well row id each mino locked into, resolved to a current row on demand (see TetrominoWell_locked_coords)
+  uint32_t (*mino_row)[MINO_CNT];
   size_t cap, cnt;
 } TetrominoCollection;
 
+typedef uint32_t WellWord;
+
 typedef struct {
   size_t rows, cols;
+  // Words per row. A standard well fits a row in a single word, wider wells spill into several.
+  size_t words;
+  // Row-major occupancy bitboard of rows * words. Bit c of word w is column w * WELL_WORD_BITS + c.
+  WellWord *bits;
+  // Per-word value of a completely filled row
+  WellWord *full;
+  // Occupied cells per row and a bitset of the rows where that reaches cols, kept up to date as cells fill
+  uint16_t *fill;
+  uint64_t *full_rows;
+  size_t full_cnt;
+  // Stable id of every row, strictly decreasing from top to bottom. Clearing compacts ids along with the rows, so
+  // locked pieces only remember ids and never need updating when rows beneath them disappear.
+  uint32_t *row_id;
+  uint32_t next_row_id;
+  // Zobrist hash of the occupied cells. Cell keys are a per-column key rotated by the row, so a row moving down during
+  // a clear only rotates its cached XOR instead of being rehashed cell by cell.
+  uint64_t *row_hash;
+  uint64_t hash;
+  TetrominoPool *pool;
   TetrominoCollection *coll;
 } TetrominoWell;
 
+typedef enum {
+  INPUT_NONE = 0,
+  INPUT_ROTATE_LEFT = 1 << 0,
+  INPUT_ROTATE_RIGHT = 1 << 1,
+  INPUT_MOVE_LEFT = 1 << 2,
+  INPUT_MOVE_RIGHT = 1 << 3,
+  INPUT_SOFT_DROP = 1 << 4,
+  INPUT_HARD_DROP = 1 << 5,
+} EInput;
+typedef uint32_t InputMask;
+
+typedef enum { GAME_STATUS_PLAYING, GAME_STATUS_OVER } EGameStatus;
+
 typedef struct {
   TetrominoWell *well;
+  Tetromino *active;
+  uint64_t tick;
+  PieceBag bag;
+  // Upcoming pieces known to the player, hashed and searched by bots, at most GAME_HASH_MAX_PREVIEW
+  size_t preview;
+  uint32_t gravity_ticks, gravity_cnt;
+  uint32_t lock_delay, lock_cnt;
+  size_t lines;
+  // Pieces spawned so far, changes exactly when a new piece becomes active
+  uint64_t pieces;
+  EGameStatus status;
 } GameState;
 
-Tetromino *Tetromino_init(ETetrominoShape const shape, size_t const row, size_t const col);
-void Tetromino_free(Tetromino *t);
+Tetromino *Tetromino_init(TetrominoPool *const pool, ETetrominoShape const shape, size_t const row, size_t const col);
+TetrominoRotation const *Tetromino_rotation(Tetromino const *const t);
+uint64_t Tetromino_hash(Tetromino const *const t);
+void Tetromino_free(TetrominoPool *const pool, Tetromino *t);
 void Tetromino_hide_mino(Tetromino *const t, uint8_t const row);
-void Tetromino_shift_mino(Tetromino *const t, size_t const mino_idx, size_t const row_shift);
 void Tetromino_translate(Tetromino *const t, size_t const row_shift, size_t const col_shift);
+void Tetromino_rotate(Tetromino *const t, uint32_t const deg);
+
+TetrominoPool *TetrominoPool_init(size_t const cap);
+void TetrominoPool_free(TetrominoPool *pool);
+void TetrominoPool_reset(TetrominoPool *const pool);
 
 TetrominoCollection *TetrominoCollection_init(size_t const cap);
 void TetrominoCollection_free(TetrominoCollection *coll);
-void TetrominoCollection_push(TetrominoCollection *const coll, Tetromino *const t);
+void TetrominoCollection_push(TetrominoCollection *const coll, Tetromino const *const t);
 void TetrominoCollection_resize(TetrominoCollection *const coll);
+Tetromino TetrominoCollection_get(TetrominoCollection const *const coll, size_t const idx);
+
+MinoCoords TetrominoWell_coords(Tetromino const *const t);
+TetrominoWell *TetrominoWell_init(size_t const rows, size_t const cols);
+void TetrominoWell_free(TetrominoWell *w);
+void TetrominoWell_reset(TetrominoWell *const w);
+void TetrominoWell_copy(TetrominoWell *const dst, TetrominoWell const *const src);
+bool TetrominoWell_occupied(TetrominoWell const *const w, size_t const row, size_t const col);
+void TetrominoWell_fill(TetrominoWell *const w, size_t const row, size_t const col);
+bool TetrominoWell_collision(TetrominoWell const *const w, Tetromino const *const t, size_t const row_shift,
+                             size_t const col_shift);
+void TetrominoWell_place(TetrominoWell *const w, Tetromino const *const t);
+bool TetrominoWell_place_clears(TetrominoWell const *const w, Tetromino const *const t);
+uint64_t TetrominoWell_place_hash(TetrominoWell const *const w, Tetromino const *const t);
+void TetrominoWell_lock(TetrominoWell *const w, Tetromino const *const t);
+MinoCoords TetrominoWell_locked_coords(TetrominoWell const *const w, size_t const idx, uint8_t *const mino_mask);
+bool TetrominoWell_row_full(TetrominoWell const *const w, size_t const row);
+uint64_t TetrominoWell_full_row_mask(TetrominoWell const *const w);
+size_t TetrominoWell_clear_full_rows(TetrominoWell *const w);
+
+// Turns wall-clock frame times into whole simulation ticks. Time is kept in ns * GAME_TICK_RATE, where a tick is
+// exactly 1e9 units, so no rounding error builds up at any refresh rate.
+typedef struct {
+  uint64_t last_ns;
+  uint64_t acc;
+} FrameClock;
 
-size_t *TetrominoWell_coords(Tetromino const *const t);
-TetrominoWell *TetrominoWell_init(void);
-void TetrominoWell_free(TetrominoWell *t);
+void FrameClock_init(FrameClock *const clock, uint64_t const now_ns);
+uint32_t FrameClock_advance(FrameClock *const clock, uint64_t const now_ns);
+float FrameClock_alpha(FrameClock const *const clock);
 
-GameState *GameState_init(void);
+GameState *GameState_init(uint64_t const seed);
 void GameState_free(GameState *t);
+void GameState_reset(GameState *const state, uint64_t const seed);
+EGameStatus Game_step(GameState *const state, InputMask const input);
+float Game_fall_offset(GameState const *const state, float const alpha);
+void Game_preview(GameState const *const state, ETetrominoShape *const shapes, size_t const cnt);
+uint64_t Game_queue_hash(ETetrominoShape const *const shapes, size_t const cnt);
+uint64_t Game_hash(GameState const *const state);
 
 #endif
@@ -0,0 +1,102 @@
+#include "loader.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Touches every page of an image so its faults are paid here rather than by the texture upload
+static void _AssetLoader_prefault(AssetPack const *const pack, AssetEntry const *const entry) {
+  uint8_t const *const data = AssetPack_data(pack, entry);
+  size_t const page = (size_t)sysconf(_SC_PAGESIZE);
+
+  // The mapping is page aligned, so this never reaches outside it
+  uintptr_t const start = (uintptr_t)data & ~(uintptr_t)(page - 1);
+  madvise((void *)start, (size_t)((uintptr_t)data - start + entry->size), MADV_WILLNEED);
+
+  uint8_t volatile sink = 0;
+  for (size_t off = 0; off < entry->size; off += page) {
+    sink ^= data[off];
+  }
+  (void)sink;
+}
+
+static void *_AssetLoader_run(void *const arg) {
+  AssetLoader *const loader = arg;
+  TRACE_THREAD_NAME("assets");
+  TRACE_BEGIN("asset load");
+
+  loader->pack = AssetPack_open(loader->pack_path);
+  AssetEntry const *const json = loader->pack != NULL ? AssetPack_find(loader->pack, loader->atlas_name) : NULL;
+  loader->ok = json != NULL && Atlas_parse(&loader->atlas, AssetPack_data(loader->pack, json), json->size);
+
+  for (size_t i = 0; loader->ok && i < loader->pack->header->cnt; i++) {
+    if (loader->pack->entries[i].kind == ASSET_KIND_RGBA32) {
+      _AssetLoader_prefault(loader->pack, &loader->pack->entries[i]);
+    }
+  }
+
+  TRACE_END("asset load");
+  atomic_store_explicit(&loader->done, true, memory_order_release);
+  return NULL;
+}
+
+/**
+ * @param pack_path Baked asset pack
+ * @param atlas_name Atlas JSON inside the pack
+ * @return Loader already running, NULL if the thread could not be started
+ */
+AssetLoader *AssetLoader_start(char const *const pack_path, char const *const atlas_name) {
+  AssetLoader *new = calloc(1, sizeof(AssetLoader));
+  new->pack_path = strdup(pack_path);
+  new->atlas_name = strdup(atlas_name);
+  atomic_init(&new->done, false);
+
+  if (pthread_create(&new->thread, NULL, _AssetLoader_run, new) != 0) {
+    new->joined = true;
+    AssetLoader_free(new);
+    return NULL;
+  }
+
+  return new;
+}
+
+// Never blocks, the render thread polls this once per frame
+bool AssetLoader_done(AssetLoader const *const loader) {
+  return atomic_load_explicit(&loader->done, memory_order_acquire);
+}
+
+/**
+ * Waits for the loader if it is still running.
+ *
+ * @return Whether the pack opened and the atlas parsed
+ */
+bool AssetLoader_finish(AssetLoader *const loader) {
+  if (!loader->joined) {
+    pthread_join(loader->thread, NULL);
+    loader->joined = true;
+  }
+
+  return loader->ok;
+}
+
+// Hands the pack over to the caller, who closes it
+AssetPack *AssetLoader_take_pack(AssetLoader *const loader) {
+  AssetLoader_finish(loader);
+
+  AssetPack *const pack = loader->pack;
+  loader->pack = NULL;
+  return pack;
+}
+
+void AssetLoader_free(AssetLoader *loader) {
+  if (loader == NULL) {
+    return;
+  }
+
+  AssetLoader_finish(loader);
+  AssetPack_close(loader->pack);
+  free(loader->pack_path);
+  free(loader->atlas_name);
+  free(loader);
+}
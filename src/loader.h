@@ -0,0 +1,31 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "atlas.h"
+#include "pack.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+// Opens the asset pack, parses the atlas and faults the pixels in on a background thread, so startup can bring up the
+// window meanwhile. Only creating textures is left for the render thread once done is set.
+typedef struct {
+  pthread_t thread;
+  bool joined;
+  char *pack_path;
+  char *atlas_name;
+
+  // Results, owned by the loader thread until done is set with release ordering
+  AssetPack *pack;
+  Atlas atlas;
+  bool ok;
+  _Atomic bool done;
+} AssetLoader;
+
+AssetLoader *AssetLoader_start(char const *const pack_path, char const *const atlas_name);
+bool AssetLoader_done(AssetLoader const *const loader);
+bool AssetLoader_finish(AssetLoader *const loader);
+AssetPack *AssetLoader_take_pack(AssetLoader *const loader);
+void AssetLoader_free(AssetLoader *loader);
+
+#endif
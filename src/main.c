@@ -1,4 +1,10 @@
+#include "bot.h"
+#include "frametime.h"
 #include "game.h"
+#include "loader.h"
+#include "render.h"
+#include "replay.h"
+#include "trace.h"
 #define SDL_MAIN_USE_CALLBACKS 1
 
 #include "_gen/cmake_variables.h"
@@ -8,15 +14,32 @@
 #include <SDL3/SDL_render.h>
 #include <SDL3/SDL_video.h>
 #include <stdio.h>
+#include <string.h>
 
 static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
+static InputMask input = INPUT_NONE;
+static FrameClock frame_clock;
+static SpriteBatch *batch = NULL;
+static StackCache *stack = NULL;
+static FrameTimes frame_times;
+// Toggled with D
+static bool show_frame_times = false;
+// Running from SDL_AppInit until the first frame that finds it done
+static AssetLoader *loader = NULL;
+static AssetPack *assets = NULL;
+static Atlas atlas;
+static WellView view = {0};
+// Demo mode, the bot plays instead of the keyboard
+static Bot *bot = NULL;
+// Set by --record, the first game is written out until it ends
+static ReplayWriter *recording = NULL;
 
 void stdoutLog(void *UNUSED(userdata), int UNUSED(category), SDL_LogPriority UNUSED(priority), const char *message) {
   printf("%s\n", message);
 }
 
-SDL_AppResult SDL_AppInit(void **UNUSED(appstate), int UNUSED(argc), char *UNUSED(argv[])) {
+SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[]) {
   SDL_SetLogPriorities(SDL_LOG_PRIORITY_DEBUG);
   SDL_SetLogOutputFunction(stdoutLog, NULL);
 
@@ -32,33 +55,255 @@ SDL_AppResult SDL_AppInit(void **UNUSED(appstate), int UNUSED(argc), char *UNUSE
     return SDL_APP_FAILURE;
   }
 
-  // TODO: initialize GameState
+  // Tracing starts before anything else so the trace covers startup, only TETRIS_TRACE builds can trace
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--trace") == 0 && !Trace_start(argv[i + 1])) {
+#ifdef TETRIS_TRACE
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Trace to %s", argv[i + 1]);
+#else
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Trace to %s: built without TETRIS_TRACE", argv[i + 1]);
+#endif
+      return SDL_APP_FAILURE;
+    }
+  }
+  TRACE_THREAD_NAME("main");
+
+  // Assets load while the window and renderer come up, frames are drawn without them until they are in
+  char *pack_path = NULL;
+  SDL_asprintf(&pack_path, "%s%s", SDL_GetBasePath(), "assets.pak");
+  loader = AssetLoader_start(pack_path, "pixel_at_time.json");
+  SDL_free(pack_path);
+  if (loader == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Start asset loader");
+    return SDL_APP_FAILURE;
+  }
+
+  uint64_t const seed = SDL_GetTicksNS();
+  GameState *state = GameState_init(seed);
+  *appstate = state;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--demo") == 0) {
+      bot = Bot_init(&BOT_CONFIG_DEFAULT);
+      if (bot == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Start bot");
+        return SDL_APP_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      char const *const path = argv[++i];
+      recording = ReplayWriter_init(path, state, seed);
+      if (recording == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Record replay to %s", path);
+        return SDL_APP_FAILURE;
+      }
+    } else if (strcmp(argv[i], "--trace") == 0) {
+      i++;
+    }
+  }
 
-  if (!SDL_CreateWindowAndRenderer(CMAKE_PROJECT_NAME, 100, 100,
+  if (!SDL_CreateWindowAndRenderer(CMAKE_PROJECT_NAME, WELL_COLS * RENDER_MINO_PIXELS, WELL_ROWS * RENDER_MINO_PIXELS,
                                    /* SDL_WINDOW_FULLSCREEN | SDL_WINDOW_BORDERLESS, */
                                    0, &window, &renderer)) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Init window and renderer: %s", SDL_GetError());
     return SDL_APP_FAILURE;
   }
+  batch = SpriteBatch_init(RENDER_PIECE_QUADS);
+  stack = StackCache_init(renderer, state->well, RENDER_MINO_PIXELS);
+
+  // Presenting paces the loop, the frame clock keeps the simulation on its own fixed tick rate
+  SDL_SetRenderVSync(renderer, 1);
+  FrameClock_init(&frame_clock, SDL_GetTicksNS());
 
   return SDL_APP_CONTINUE;
 }
 
-SDL_AppResult SDL_AppEvent(void *UNUSED(appstate), SDL_Event *event) {
+// Render thread half of loading: everything is decoded and faulted in, only the texture upload is left
+static SDL_AppResult _App_assets_ready(void) {
+  bool const ok = AssetLoader_finish(loader);
+  atlas = loader->atlas;
+  assets = AssetLoader_take_pack(loader);
+  AssetLoader_free(loader);
+  loader = NULL;
+
+  if (!ok) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Load assets.pak with atlas pixel_at_time.json");
+    return SDL_APP_FAILURE;
+  }
+
+  // One sheet for everything, loaded once and shared by all draws
+  SDL_Texture *const texture = Atlas_texture(renderer, &atlas, assets);
+  if (texture == NULL) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Load atlas texture %s: %s", atlas.image, SDL_GetError());
+    return SDL_APP_FAILURE;
+  }
+
+  // Every shape uses the sheet's one mino frame, told apart by tint
+  static const SDL_FColor tints[TETROMINO_SHAPE_CNT] = {
+      [TETROMINO_SHAPE_I] = {0.0f, 0.9f, 0.9f, 1.0f}, [TETROMINO_SHAPE_J] = {0.2f, 0.3f, 1.0f, 1.0f},
+      [TETROMINO_SHAPE_L] = {1.0f, 0.6f, 0.1f, 1.0f}, [TETROMINO_SHAPE_O] = {1.0f, 0.9f, 0.1f, 1.0f},
+      [TETROMINO_SHAPE_S] = {0.2f, 0.9f, 0.2f, 1.0f}, [TETROMINO_SHAPE_T] = {0.7f, 0.2f, 0.9f, 1.0f},
+      [TETROMINO_SHAPE_Z] = {1.0f, 0.2f, 0.2f, 1.0f},
+  };
+  WellView_init(&view, &atlas, texture);
+  memcpy(view.tint, tints, sizeof(tints));
+  StackCache_invalidate(stack);
+
+  return SDL_APP_CONTINUE;
+}
+
+static SDL_AppResult _App_event(SDL_Event const *const event) {
   if (event->type == SDL_EVENT_QUIT) {
     return SDL_APP_SUCCESS;
   }
+
+  // Render targets lose their contents with the device, the cached stack has to be drawn again
+  if (event->type == SDL_EVENT_RENDER_TARGETS_RESET || event->type == SDL_EVENT_RENDER_DEVICE_RESET) {
+    StackCache_invalidate(stack);
+    return SDL_APP_CONTINUE;
+  }
+
+  if (event->type == SDL_EVENT_KEY_DOWN && event->key.scancode == SDL_SCANCODE_D) {
+    show_frame_times = !show_frame_times;
+    return SDL_APP_CONTINUE;
+  }
+
+  if (event->type == SDL_EVENT_KEY_DOWN && event->key.scancode == SDL_SCANCODE_B) {
+    if (bot == NULL) {
+      bot = Bot_init(&BOT_CONFIG_DEFAULT);
+      if (bot == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Start bot");
+      }
+    } else {
+      Bot_free(bot);
+      bot = NULL;
+    }
+    return SDL_APP_CONTINUE;
+  }
+
+  if (event->type == SDL_EVENT_KEY_DOWN && bot == NULL) {
+    switch (event->key.scancode) {
+    case SDL_SCANCODE_UP:
+    case SDL_SCANCODE_K:
+      input |= INPUT_ROTATE_RIGHT;
+      break;
+    case SDL_SCANCODE_J:
+      input |= INPUT_ROTATE_LEFT;
+      break;
+    case SDL_SCANCODE_LEFT:
+      input |= INPUT_MOVE_LEFT;
+      break;
+    case SDL_SCANCODE_RIGHT:
+      input |= INPUT_MOVE_RIGHT;
+      break;
+    case SDL_SCANCODE_DOWN:
+      input |= INPUT_SOFT_DROP;
+      break;
+    case SDL_SCANCODE_SPACE:
+      input |= INPUT_HARD_DROP;
+      break;
+    default:
+      break;
+    }
+  }
+
   return SDL_APP_CONTINUE;
-  ;
 }
 
-SDL_AppResult SDL_AppIterate(void *UNUSED(appstate)) {
+SDL_AppResult SDL_AppEvent(void *UNUSED(appstate), SDL_Event *event) {
+  // Events arrive one call each between frames, they all add up into the next frame's input time
+  FrameTimer const timer = FrameTimer_begin(&frame_times, FRAME_PHASE_INPUT);
+  TRACE_BEGIN("input");
+  SDL_AppResult const result = _App_event(event);
+  TRACE_END("input");
+  FrameTimer_end(&timer);
+
+  return result;
+}
+
+SDL_AppResult SDL_AppIterate(void *appstate) {
+  GameState *state = appstate;
+
+  if (loader != NULL && AssetLoader_done(loader)) {
+    SDL_AppResult const loaded = _App_assets_ready();
+    if (loaded != SDL_APP_CONTINUE) {
+      return loaded;
+    }
+  }
+
+  FrameTimer const sim = FrameTimer_begin(&frame_times, FRAME_PHASE_SIM);
+  TRACE_BEGIN("sim");
+  uint32_t const ticks = FrameClock_advance(&frame_clock, SDL_GetTicksNS());
+  for (uint32_t t = 0; t < ticks; t++) {
+    // Keys pressed since the last tick apply to the first tick of this frame, on frames without a tick they wait
+    InputMask const step = bot != NULL ? Bot_input(bot, state) : input;
+    input = INPUT_NONE;
+
+    TRACE_BEGIN("tick");
+    EGameStatus const status = Game_step(state, step);
+    TRACE_END("tick");
+    if (recording != NULL) {
+      ReplayWriter_step(recording, state, step);
+    }
+
+    if (status == GAME_STATUS_OVER) {
+      if (recording != NULL && !ReplayWriter_close(recording, state)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Write replay");
+      }
+      recording = NULL;
+
+      // Demo mode loops as an attract screen
+      if (bot == NULL) {
+        TRACE_END("sim");
+        return SDL_APP_SUCCESS;
+      }
+      GameState_reset(state, SDL_GetTicksNS());
+      Bot_reset(bot);
+    }
+  }
+  TRACE_END("sim");
+  FrameTimer_end(&sim);
+
+  FrameTimer const render = FrameTimer_begin(&frame_times, FRAME_PHASE_RENDER);
+  TRACE_BEGIN("render");
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+  SDL_RenderClear(renderer);
+
+  // Locked minos only get redrawn into their cache on the frames they change, the pieces on top are one draw call
+  if (view.texture != NULL) {
+    StackCache_update(stack, renderer, &view, state->well);
+    StackCache_draw(stack, renderer, &view);
+    WellView_build_pieces(&view, batch, state, FrameClock_alpha(&frame_clock));
+    SpriteBatch_draw(batch, renderer, view.texture);
+  }
+
+  if (show_frame_times) {
+    FrameTimes_draw(&frame_times, renderer, 4, 4);
+  }
+  TRACE_END("render");
+  FrameTimer_end(&render);
+
+  // Includes waiting for vsync, a frame within budget spends its spare time here
+  FrameTimer const present = FrameTimer_begin(&frame_times, FRAME_PHASE_PRESENT);
+  TRACE_BEGIN("present");
+  SDL_RenderPresent(renderer);
+  TRACE_END("present");
+  FrameTimer_end(&present);
+  FrameTimes_commit(&frame_times);
 
-  Tetromino *t = Tetromino_init(TETROMINO_SHAPE_I, 0, 0);
-  TetrominoCollection *coll = TetrominoCollection_init(100);
-  TetrominoCollection_push(coll, t);
-  TetrominoCollection_free(coll);
   return SDL_APP_CONTINUE;
 }
 
-void SDL_AppQuit(void *UNUSED(appstate), SDL_AppResult UNUSED(result)) { return; }
+void SDL_AppQuit(void *appstate, SDL_AppResult UNUSED(result)) {
+  if (recording != NULL && !ReplayWriter_close(recording, appstate)) {
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Write replay");
+  }
+  StackCache_free(stack);
+  SpriteBatch_free(batch);
+  SDL_DestroyTexture(view.texture);
+  AssetLoader_free(loader);
+  AssetPack_close(assets);
+  Bot_free(bot);
+  GameState_free(appstate);
+  // Last, the loader thread is joined by now
+  Trace_stop();
+}
@@ -0,0 +1,265 @@
+#include "movegen.h"
+#include <assert.h>
+#include <string.h>
+
+typedef struct {
+  uint8_t top[TETROMINO_ROTATION_CNT];
+  // Lowest rotation with the same footprint as each rotation, so symmetric pieces yield each placement once
+  uint8_t canon[TETROMINO_ROTATION_CNT];
+} _MoveGenShape;
+
+static void _MoveGenShape_init(_MoveGenShape *const info, ETetrominoShape const shape) {
+  // Footprints compared after shifting them into the top left corner of the bounding box
+  uint8_t norm[TETROMINO_ROTATION_CNT][MINO_CNT] = {0};
+
+  for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+    TetrominoRotation const *const rot = &TETROMINO_ROTATIONS[shape][q];
+
+    size_t top = 0;
+    while (rot->rows[top] == 0) {
+      top++;
+    }
+    info->top[q] = (uint8_t)top;
+
+    for (size_t r = top; r < MINO_CNT; r++) {
+      norm[q][r - top] = rot->rows[r] >> rot->left;
+    }
+
+    info->canon[q] = (uint8_t)q;
+    for (size_t p = 0; p < q; p++) {
+      if (memcmp(norm[p], norm[q], MINO_CNT) == 0) {
+        info->canon[q] = info->canon[p];
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * Every column reachable from x by sliding sideways through legal ones, filling in log steps rather than a column
+ * at a time.
+ */
+static inline MoveGenRow _MoveGen_slide(MoveGenRow const x, MoveGenRow const legal) {
+  // Rows inherited whole from the one above are common and already closed
+  if ((((x << 1) | (x >> 1)) & legal & ~x) == 0) {
+    return x;
+  }
+
+  MoveGenRow left = x, right = x;
+  MoveGenRow lm = legal, rm = legal;
+  for (int step = 1; step < 64; step *= 2) {
+    left |= lm & (left << step);
+    right |= rm & (right >> step);
+    lm &= lm << step;
+    rm &= rm >> step;
+  }
+  return left | right;
+}
+
+/**
+ * Fills in the legal columns of every rotation and row.
+ *
+ * @return Rows used, row index ri holds row0 = ri - PAD, with one always-illegal row past the floor
+ */
+static size_t _MoveGen_legal(MoveGen *const gen, TetrominoWell const *const w, ETetrominoShape const shape) {
+  size_t const rows = w->rows + MOVEGEN_PAD + 1;
+  for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+    for (size_t ri = 0; ri < rows; ri++) {
+      gen->legal[q][ri] = TetrominoWell_legal_cols(w, shape, q, (ptrdiff_t)ri - MOVEGEN_PAD);
+    }
+  }
+  return rows;
+}
+
+static inline MoveGenRow _MoveGen_shift(MoveGenRow const x, int const by) { return by >= 0 ? x << by : x >> -by; }
+
+/**
+ * Enumerates every distinct placement the tetromino can lock into from its current pose.
+ *
+ * A breadth first flood fill over (rotation, row, col) using the moves a player has: shift left or right, drop one row
+ * and rotate either way. The visited set is a bitset holding a whole row of columns per word, so each step expands
+ * every column of a row at once. Slides under overhangs and rotations into tight spots fall out naturally, and poses
+ * covering the same cells, as the rotations of an O do, are reported once.
+ *
+ * @param gen Scratch space, results are left in gen->placements
+ * @param w Well the tetromino moves in
+ * @param t Tetromino to place, must not collide where it is
+ * @return Number of placements found
+ */
+size_t MoveGen_placements(MoveGen *const gen, TetrominoWell const *const w, Tetromino const *const t) {
+  assert(w->rows <= MOVEGEN_MAX_ROWS && w->cols <= MOVEGEN_MAX_COLS && "well too large for MoveGen");
+  assert(!TetrominoWell_collision(w, t, 0, 0) && "tetromino must start in a free spot");
+
+  _MoveGenShape info;
+  _MoveGenShape_init(&info, t->shape);
+
+  size_t const rows = _MoveGen_legal(gen, w, t->shape);
+  for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+    for (size_t ri = 0; ri < rows; ri++) {
+      gen->reach[q][ri] = 0;
+      gen->landed[q][ri] = 0;
+      gen->spin[q][ri] = 0;
+    }
+  }
+
+  size_t const start_q = t->deg / 90;
+  size_t const start_ri = (size_t)((ptrdiff_t)t->row0 + MOVEGEN_PAD);
+  gen->reach[start_q][start_ri] = 1ULL << ((ptrdiff_t)t->col0 + MOVEGEN_PAD);
+
+  // No move goes up, so one sweep down the well settles each row before dropping into the next
+  for (size_t ri = start_ri; ri + 1 < rows; ri++) {
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+        MoveGenRow const x = _MoveGen_slide(gen->reach[q][ri], gen->legal[q][ri]);
+        size_t const cw = (q + 1) % TETROMINO_ROTATION_CNT;
+        size_t const ccw = (q + 3) % TETROMINO_ROTATION_CNT;
+        MoveGenRow const rot_cw = gen->reach[cw][ri] | (x & gen->legal[cw][ri]);
+        MoveGenRow const rot_ccw = gen->reach[ccw][ri] | (x & gen->legal[ccw][ri]);
+
+        // Rotating into a later rotation is picked up further along this pass
+        changed |= (rot_cw != gen->reach[cw][ri] && cw < q) || (rot_ccw != gen->reach[ccw][ri] && ccw < q);
+        gen->reach[q][ri] = x;
+        gen->reach[cw][ri] = rot_cw;
+        gen->reach[ccw][ri] = rot_ccw;
+      }
+    }
+
+    for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+      gen->reach[q][ri + 1] = gen->reach[q][ri] & gen->legal[q][ri + 1];
+    }
+  }
+
+  // Land every state that cannot drop, folding symmetric rotations onto their canonical pose
+  for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+    size_t const p = info.canon[q];
+    int const dr = info.top[q] - info.top[p];
+    int const dc = TETROMINO_ROTATIONS[t->shape][q].left - TETROMINO_ROTATIONS[t->shape][p].left;
+
+    for (size_t ri = 1; ri + 1 < rows; ri++) {
+      MoveGenRow const legal = gen->legal[q][ri];
+      MoveGenRow const landed = gen->reach[q][ri] & ~gen->legal[q][ri + 1];
+      if (landed == 0) {
+        continue;
+      }
+
+      MoveGenRow const stuck = ~gen->legal[q][ri - 1] & ~(legal << 1) & ~(legal >> 1);
+      gen->landed[p][ri + dr] |= _MoveGen_shift(landed, dc);
+      gen->spin[p][ri + dr] |= _MoveGen_shift(landed & stuck, dc);
+    }
+  }
+
+  gen->cnt = 0;
+  for (size_t p = 0; p < TETROMINO_ROTATION_CNT; p++) {
+    for (size_t ri = 0; ri < rows; ri++) {
+      for (MoveGenRow x = gen->landed[p][ri]; x; x &= x - 1) {
+        int const i = __builtin_ctzll(x);
+        gen->placements[gen->cnt++] = (Placement){.row0 = (int16_t)((int)ri - MOVEGEN_PAD),
+                                                  .col0 = (int16_t)(i - MOVEGEN_PAD),
+                                                  .rotation = (uint8_t)p,
+                                                  .spin = (gen->spin[p][ri] >> i) & 1};
+      }
+    }
+  }
+
+  return gen->cnt;
+}
+
+// Moves in the order paths prefer them, rotating and shifting before dropping
+static const struct {
+  int8_t drot, drow, dcol;
+  InputMask input;
+} MOVEGEN_MOVES[] = {
+    {1, 0, 0, INPUT_ROTATE_RIGHT}, {3, 0, 0, INPUT_ROTATE_LEFT}, {0, 0, -1, INPUT_MOVE_LEFT},
+    {0, 0, 1, INPUT_MOVE_RIGHT},   {0, 1, 0, INPUT_SOFT_DROP},
+};
+
+#define MOVEGEN_MOVE_CNT (sizeof(MOVEGEN_MOVES) / sizeof(MOVEGEN_MOVES[0]))
+#define MOVEGEN_STATE(q, ri, i) ((uint16_t)(((q) * MOVEGEN_ROWS + (ri)) * 64 + (i)))
+
+/**
+ * Finds the shortest sequence of inputs taking the tetromino into a placement, one input per tick.
+ *
+ * A plain breadth first search with a parent move per state, since placements only keep what is reachable, not how.
+ *
+ * @param target Placement as found by MoveGen_placements for the same well and shape
+ * @param moves Receives up to cap inputs of the path, in order
+ * @return Length of the path, 0 when already there, MOVEGEN_NO_PATH when the placement cannot be reached
+ */
+size_t MoveGen_path(MoveGen *const gen, TetrominoWell const *const w, Tetromino const *const t,
+                    Placement const target, InputMask *const moves, size_t const cap) {
+  assert(w->rows <= MOVEGEN_MAX_ROWS && w->cols <= MOVEGEN_MAX_COLS && "well too large for MoveGen");
+
+  _MoveGenShape info;
+  _MoveGenShape_init(&info, t->shape);
+
+  size_t const rows = _MoveGen_legal(gen, w, t->shape);
+  for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+    memset(gen->from[q], 0, sizeof(gen->from[q][0]) * rows);
+  }
+
+  // Each rotation's pose that covers the target cells
+  ptrdiff_t goal_ri[TETROMINO_ROTATION_CNT], goal_i[TETROMINO_ROTATION_CNT];
+  for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+    size_t const p = info.canon[q];
+    goal_ri[q] = p == target.rotation ? target.row0 + MOVEGEN_PAD - (info.top[q] - info.top[p]) : -1;
+    goal_i[q] = target.col0 + MOVEGEN_PAD -
+                (TETROMINO_ROTATIONS[t->shape][q].left - TETROMINO_ROTATIONS[t->shape][p].left);
+  }
+
+  size_t const start_q = t->deg / 90;
+  size_t const start_ri = (size_t)((ptrdiff_t)t->row0 + MOVEGEN_PAD);
+  size_t const start_i = (size_t)((ptrdiff_t)t->col0 + MOVEGEN_PAD);
+  gen->from[start_q][start_ri][start_i] = MOVEGEN_MOVE_CNT + 1;
+  gen->queue[0] = MOVEGEN_STATE(start_q, start_ri, start_i);
+
+  for (size_t head = 0, tail = 1; head < tail; head++) {
+    size_t const i = gen->queue[head] % 64;
+    size_t const ri = gen->queue[head] / 64 % MOVEGEN_ROWS;
+    size_t const q = gen->queue[head] / 64 / MOVEGEN_ROWS;
+
+    if ((ptrdiff_t)ri == goal_ri[q] && (ptrdiff_t)i == goal_i[q]) {
+      // Walk the parents back twice, once to measure the path and once to write it out front to back
+      size_t len = 0;
+      for (size_t pass = 0; pass < 2; pass++) {
+        size_t cq = q, cri = ri, ci = i, k = len;
+        for (uint8_t m; (m = gen->from[cq][cri][ci]) <= MOVEGEN_MOVE_CNT;) {
+          if (pass == 0) {
+            len++;
+          } else if (--k < cap) {
+            moves[k] = MOVEGEN_MOVES[m - 1].input;
+          }
+          cq = (cq + TETROMINO_ROTATION_CNT - MOVEGEN_MOVES[m - 1].drot) % TETROMINO_ROTATION_CNT;
+          cri -= (size_t)MOVEGEN_MOVES[m - 1].drow;
+          ci -= (size_t)(ptrdiff_t)MOVEGEN_MOVES[m - 1].dcol;
+        }
+      }
+      return len;
+    }
+
+    for (size_t m = 0; m < MOVEGEN_MOVE_CNT; m++) {
+      size_t const nq = (q + (size_t)MOVEGEN_MOVES[m].drot) % TETROMINO_ROTATION_CNT;
+      size_t const nri = ri + (size_t)MOVEGEN_MOVES[m].drow;
+      size_t const ni = i + (size_t)(ptrdiff_t)MOVEGEN_MOVES[m].dcol;
+
+      // Illegal bits cover both walls, and the row past the floor is never legal
+      if (ni >= 64 || nri >= rows || !((gen->legal[nq][nri] >> ni) & 1) || gen->from[nq][nri][ni]) {
+        continue;
+      }
+
+      gen->from[nq][nri][ni] = (uint8_t)(m + 1);
+      gen->queue[tail++] = MOVEGEN_STATE(nq, nri, ni);
+    }
+  }
+
+  return MOVEGEN_NO_PATH;
+}
+
+Tetromino Placement_tetromino(Placement const p, ETetrominoShape const shape) {
+  return (Tetromino){.row0 = (size_t)(ptrdiff_t)p.row0,
+                     .col0 = (size_t)(ptrdiff_t)p.col0,
+                     .deg = p.rotation * 90u,
+                     .shape = shape,
+                     .state = TETROMINO_STATE_ACTIVE};
+}
@@ -0,0 +1,48 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "collide.h"
+#include "game.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MOVEGEN_MAX_ROWS 64
+#define MOVEGEN_MAX_COLS COLLIDE_MAX_COLS
+// Bounding boxes may hang up to this far over the top and left walls, matching the column bias of ColMask
+#define MOVEGEN_PAD COLLIDE_COL_BIAS
+#define MOVEGEN_ROWS (MOVEGEN_MAX_ROWS + MOVEGEN_PAD + 1)
+#define MOVEGEN_MAX_STATES (TETROMINO_ROTATION_CNT * MOVEGEN_ROWS * 64)
+#define MOVEGEN_NO_PATH SIZE_MAX
+#define MOVEGEN_MAX_PLACEMENTS (TETROMINO_ROTATION_CNT * MOVEGEN_MAX_ROWS * MOVEGEN_MAX_COLS)
+
+typedef struct {
+  int16_t row0, col0;
+  uint8_t rotation;
+  // Locked where the piece can neither slide nor lift out, so only a rotation could have put it there
+  bool spin;
+} Placement;
+
+// Per rotation and row, one bit per col0 as in ColMask, so a whole row of states is handled at once
+typedef ColMask MoveGenRow;
+
+// Scratch space and results of a search. Large, so keep one around per thread rather than on the stack.
+typedef struct {
+  MoveGenRow legal[TETROMINO_ROTATION_CNT][MOVEGEN_ROWS];
+  MoveGenRow reach[TETROMINO_ROTATION_CNT][MOVEGEN_ROWS];
+  MoveGenRow landed[TETROMINO_ROTATION_CNT][MOVEGEN_ROWS];
+  MoveGenRow spin[TETROMINO_ROTATION_CNT][MOVEGEN_ROWS];
+  Placement placements[MOVEGEN_MAX_PLACEMENTS];
+  size_t cnt;
+
+  // Path search only: the move that first reached each state, and the breadth first queue
+  uint8_t from[TETROMINO_ROTATION_CNT][MOVEGEN_ROWS][64];
+  uint16_t queue[MOVEGEN_MAX_STATES];
+} MoveGen;
+
+size_t MoveGen_placements(MoveGen *const gen, TetrominoWell const *const w, Tetromino const *const t);
+size_t MoveGen_path(MoveGen *const gen, TetrominoWell const *const w, Tetromino const *const t,
+                    Placement const target, InputMask *const moves, size_t const cap);
+Tetromino Placement_tetromino(Placement const p, ETetrominoShape const shape);
+
+#endif
@@ -0,0 +1,255 @@
+#include "pack.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "asset packs are read in place as little endian");
+_Static_assert(sizeof(AssetEntry) % 8 == 0, "entries must keep their 64 bit fields aligned");
+
+static uint32_t _Bmp_u32(uint8_t const *const p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Scales the masked channel of a pixel to 8 bits, a missing alpha mask means opaque
+static uint8_t _Bmp_channel(uint32_t const px, uint32_t const mask, uint8_t const missing) {
+  if (mask == 0) {
+    return missing;
+  }
+
+  uint32_t const shift = (uint32_t)__builtin_ctz(mask);
+  uint32_t const max = mask >> shift;
+  return (uint8_t)(((px & mask) >> shift) * 255 / max);
+}
+
+/**
+ * Decodes an uncompressed 24 bit or 32 bit (plain or bitfields) BMP, which covers what Aseprite and SDL_SaveBMP write.
+ *
+ * @return Pixels as RGBA32 rows top to bottom, NULL when the file is not such a BMP
+ */
+static uint8_t *_Bmp_decode(uint8_t const *const bmp, size_t const len, uint32_t *const w, uint32_t *const h) {
+  if (len < 54 || bmp[0] != 'B' || bmp[1] != 'M') {
+    return NULL;
+  }
+
+  uint32_t const pixels = _Bmp_u32(&bmp[10]);
+  uint32_t const header = _Bmp_u32(&bmp[14]);
+  int32_t const width = (int32_t)_Bmp_u32(&bmp[18]);
+  int32_t const height = (int32_t)_Bmp_u32(&bmp[22]);
+  uint16_t const bpp = (uint16_t)(bmp[28] | bmp[29] << 8);
+  uint32_t const compression = _Bmp_u32(&bmp[30]);
+
+  uint32_t masks[4] = {0xFF0000, 0xFF00, 0xFF, bpp == 32 ? 0xFF000000 : 0};
+  if (compression == 3 && 14 + 40 + 16 <= len) {
+    // Bitfield masks live inside V3+ headers or right after a plain 40 byte one
+    for (size_t c = 0; c < (header >= 56 ? 4u : 3u); c++) {
+      masks[c] = _Bmp_u32(&bmp[14 + 40 + 4 * c]);
+    }
+  } else if (compression != 0) {
+    return NULL;
+  }
+
+  if (width <= 0 || height == 0 || width > 16384 || height > 16384 || height < -16384 || (bpp != 24 && bpp != 32)) {
+    return NULL;
+  }
+
+  *w = (uint32_t)width;
+  *h = (uint32_t)(height < 0 ? -height : height);
+  size_t const stride = ((size_t)*w * bpp / 8 + 3) & ~(size_t)3;
+  if (pixels > len || stride * *h > len - pixels) {
+    return NULL;
+  }
+
+  uint8_t *const out = malloc((size_t)*w * *h * 4);
+  if (out == NULL) {
+    return NULL;
+  }
+  for (uint32_t y = 0; y < *h; y++) {
+    // Positive heights are stored bottom up
+    uint8_t const *src = &bmp[pixels + stride * (height < 0 ? y : *h - 1 - y)];
+    uint8_t *dst = &out[(size_t)y * *w * 4];
+
+    for (uint32_t x = 0; x < *w; x++, src += bpp / 8, dst += 4) {
+      uint32_t const px = bpp == 32 ? _Bmp_u32(src) : (uint32_t)src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16;
+      dst[0] = _Bmp_channel(px, masks[0], 0);
+      dst[1] = _Bmp_channel(px, masks[1], 0);
+      dst[2] = _Bmp_channel(px, masks[2], 0);
+      dst[3] = _Bmp_channel(px, masks[3], 0xFF);
+    }
+  }
+
+  return out;
+}
+
+static uint8_t *_AssetPack_read(char const *const path, size_t *const len) {
+  FILE *const file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+
+  uint8_t *data = NULL;
+  long const size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+  if (size >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+    data = malloc((size_t)size + 1);
+    *len = data != NULL ? fread(data, 1, (size_t)size, file) : 0;
+    if (*len != (size_t)size) {
+      free(data);
+      data = NULL;
+    }
+  }
+
+  fclose(file);
+  return data;
+}
+
+/**
+ * Packs assets into one file. BMP images are decoded to RGBA32 and named by their stem, anything else is stored as is
+ * under its file name.
+ *
+ * @param paths Asset files, only their base names end up in the pack
+ * @return False when an asset cannot be read or decoded, or the pack cannot be written
+ */
+bool AssetPack_bake(char const *const out_path, char const *const *const paths, size_t const cnt) {
+  AssetEntry *const entries = calloc(cnt, sizeof(AssetEntry));
+  uint8_t **const blobs = calloc(cnt, sizeof(uint8_t *));
+  uint64_t offset = sizeof(AssetPackHeader) + sizeof(AssetEntry) * cnt;
+  bool ok = true;
+
+  for (size_t i = 0; i < cnt && ok; i++) {
+    char const *const slash = strrchr(paths[i], '/');
+    char const *const name = slash != NULL ? slash + 1 : paths[i];
+    char const *const ext = strrchr(name, '.');
+    AssetEntry *const e = &entries[i];
+
+    size_t len = 0;
+    blobs[i] = _AssetPack_read(paths[i], &len);
+    ok = blobs[i] != NULL && strlen(name) < ASSET_NAME_SIZE;
+
+    if (ok && ext != NULL && strcmp(ext, ".bmp") == 0) {
+      uint8_t *const pixels = _Bmp_decode(blobs[i], len, &e->w, &e->h);
+      free(blobs[i]);
+      blobs[i] = pixels;
+      ok = pixels != NULL;
+
+      memcpy(e->name, name, (size_t)(ext - name));
+      e->kind = ASSET_KIND_RGBA32;
+      e->pitch = e->w * 4;
+      len = (size_t)e->pitch * e->h;
+    } else if (ok) {
+      strcpy(e->name, name);
+      e->kind = ASSET_KIND_RAW;
+    }
+
+    offset = (offset + ASSET_PACK_ALIGN - 1) & ~(uint64_t)(ASSET_PACK_ALIGN - 1);
+    e->offset = offset;
+    e->size = len;
+    offset += len;
+  }
+
+  FILE *const file = ok ? fopen(out_path, "wb") : NULL;
+  if (file != NULL) {
+    AssetPackHeader header = {.version = ASSET_PACK_VERSION, .cnt = (uint32_t)cnt};
+    memcpy(header.magic, ASSET_PACK_MAGIC, 4);
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(entries, sizeof(AssetEntry), cnt, file);
+
+    static const uint8_t zeros[ASSET_PACK_ALIGN] = {0};
+    for (size_t i = 0; i < cnt; i++) {
+      fwrite(zeros, 1, (size_t)(entries[i].offset - (uint64_t)ftell(file)), file);
+      fwrite(blobs[i], 1, entries[i].size, file);
+    }
+
+    ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+  } else {
+    ok = false;
+  }
+
+  for (size_t i = 0; i < cnt; i++) {
+    free(blobs[i]);
+  }
+  free(blobs);
+  free(entries);
+
+  return ok;
+}
+
+/**
+ * Maps a baked pack and checks its index.
+ *
+ * @return Pack, NULL when the file is missing, of another version, or an entry's bytes or pixel rows lie outside it
+ */
+AssetPack *AssetPack_open(char const *const path) {
+  int const fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(AssetPackHeader)) {
+    close(fd);
+    return NULL;
+  }
+
+  size_t const size = (size_t)st.st_size;
+  void *const data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+
+  AssetPackHeader const *const header = data;
+  bool ok = memcmp(header->magic, ASSET_PACK_MAGIC, 4) == 0 && header->version == ASSET_PACK_VERSION &&
+            header->cnt <= (size - sizeof(AssetPackHeader)) / sizeof(AssetEntry);
+
+  AssetEntry const *const entries = (AssetEntry const *)(header + 1);
+  for (size_t i = 0; ok && i < header->cnt; i++) {
+    AssetEntry const *const e = &entries[i];
+    ok = e->offset % ASSET_PACK_ALIGN == 0 && e->offset <= size && e->size <= size - e->offset &&
+         memchr(e->name, '\0', ASSET_NAME_SIZE) != NULL &&
+         (e->kind == ASSET_KIND_RAW || (e->kind == ASSET_KIND_RGBA32 && e->pitch >= (uint64_t)e->w * 4 &&
+                                        (uint64_t)e->pitch * e->h == e->size));
+  }
+
+  if (!ok) {
+    munmap(data, size);
+    return NULL;
+  }
+
+  AssetPack *new = calloc(1, sizeof(AssetPack));
+  new->data = data;
+  new->size = size;
+  new->header = header;
+  new->entries = entries;
+
+  return new;
+}
+
+void AssetPack_close(AssetPack *pack) {
+  if (pack == NULL) {
+    return;
+  }
+
+  munmap((void *)pack->data, pack->size);
+  free(pack);
+}
+
+/**
+ * @return Entry of the named asset, NULL when the pack has none
+ */
+AssetEntry const *AssetPack_find(AssetPack const *const pack, char const *const name) {
+  for (size_t i = 0; i < pack->header->cnt; i++) {
+    if (strcmp(pack->entries[i].name, name) == 0) {
+      return &pack->entries[i];
+    }
+  }
+
+  return NULL;
+}
+
+void const *AssetPack_data(AssetPack const *const pack, AssetEntry const *const entry) {
+  return &pack->data[entry->offset];
+}
@@ -0,0 +1,51 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// File layout, native little endian so the index is used straight from the mapping:
+//   AssetPackHeader, then cnt AssetEntry, then each asset's bytes at its offset, aligned to ASSET_PACK_ALIGN
+#define ASSET_PACK_MAGIC "CTPK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGN 64
+#define ASSET_NAME_SIZE 48
+
+typedef enum {
+  // File bytes as they were, e.g. JSON
+  ASSET_KIND_RAW,
+  // Decoded image, R, G, B, A bytes per pixel, ready to upload as SDL_PIXELFORMAT_RGBA32
+  ASSET_KIND_RGBA32,
+} EAssetKind;
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t cnt;
+  uint32_t reserved;
+} AssetPackHeader;
+
+typedef struct {
+  // Raw assets keep their file name, images are named by their stem
+  char name[ASSET_NAME_SIZE];
+  uint32_t kind;
+  uint32_t w, h, pitch;
+  uint64_t offset, size;
+} AssetEntry;
+
+// A baked pack mapped read-only, every asset is used in place
+typedef struct {
+  uint8_t const *data;
+  size_t size;
+  AssetPackHeader const *header;
+  AssetEntry const *entries;
+} AssetPack;
+
+bool AssetPack_bake(char const *const out_path, char const *const *const paths, size_t const cnt);
+AssetPack *AssetPack_open(char const *const path);
+void AssetPack_close(AssetPack *pack);
+AssetEntry const *AssetPack_find(AssetPack const *const pack, char const *const name);
+void const *AssetPack_data(AssetPack const *const pack, AssetEntry const *const entry);
+
+#endif
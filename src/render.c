@@ -0,0 +1,322 @@
+#include "render.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ghost piece drawn at a fraction of its tint's opacity
+#define RENDER_GHOST_ALPHA 0.3f
+
+SpriteBatch *SpriteBatch_init(size_t const cap) {
+  SpriteBatch *new = calloc(1, sizeof(SpriteBatch));
+  new->verts = calloc(cap * 4, sizeof(SDL_Vertex));
+  new->indices = calloc(cap * 6, sizeof(int));
+  new->cap = cap;
+
+  // Two triangles per quad, corners pushed top-left, top-right, bottom-right, bottom-left
+  for (size_t q = 0; q < cap; q++) {
+    int const v = (int)(q * 4);
+    int *const idx = &new->indices[q * 6];
+    idx[0] = v;
+    idx[1] = v + 1;
+    idx[2] = v + 2;
+    idx[3] = v;
+    idx[4] = v + 2;
+    idx[5] = v + 3;
+  }
+
+  return new;
+}
+
+void SpriteBatch_free(SpriteBatch *batch) {
+  if (batch == NULL) {
+    return;
+  }
+
+  free(batch->verts);
+  free(batch->indices);
+  free(batch);
+}
+
+void SpriteBatch_clear(SpriteBatch *const batch) { batch->cnt = 0; }
+
+/**
+ * @param dst Quad in render coordinates
+ * @param uv Normalised texture rectangle mapped onto the quad
+ * @param color Tint multiplied with the texture
+ */
+void SpriteBatch_push(SpriteBatch *const batch, SDL_FRect const *const dst, SDL_FRect const *const uv,
+                      SDL_FColor const color) {
+  assert(batch->cnt < batch->cap && "sprite batch is full");
+
+  SDL_Vertex *const v = &batch->verts[batch->cnt * 4];
+  float const x1 = dst->x + dst->w, y1 = dst->y + dst->h;
+  float const u1 = uv->x + uv->w, v1 = uv->y + uv->h;
+
+  v[0] = (SDL_Vertex){{dst->x, dst->y}, color, {uv->x, uv->y}};
+  v[1] = (SDL_Vertex){{x1, dst->y}, color, {u1, uv->y}};
+  v[2] = (SDL_Vertex){{x1, y1}, color, {u1, v1}};
+  v[3] = (SDL_Vertex){{dst->x, y1}, color, {uv->x, v1}};
+
+  batch->cnt++;
+}
+
+bool SpriteBatch_draw(SpriteBatch const *const batch, SDL_Renderer *const renderer, SDL_Texture *const texture) {
+  if (batch->cnt == 0) {
+    return true;
+  }
+
+  return SDL_RenderGeometry(renderer, texture, batch->verts, (int)(batch->cnt * 4), batch->indices,
+                            (int)(batch->cnt * 6));
+}
+
+/**
+ * Creates the texture of an atlas's sheet from its pre-decoded pixels, uploaded straight from the pack's mapping.
+ *
+ * @return Texture, NULL when the pack lacks the sheet or the upload fails
+ */
+SDL_Texture *Atlas_texture(SDL_Renderer *const renderer, Atlas const *const atlas, AssetPack const *const pack) {
+  // Baked images are named by their stem, whatever format the JSON says the sheet was exported as
+  char name[ASSET_NAME_SIZE];
+  char const *const ext = strrchr(atlas->image, '.');
+  size_t const stem = ext != NULL ? (size_t)(ext - atlas->image) : strlen(atlas->image);
+  snprintf(name, sizeof(name), "%.*s", (int)stem, atlas->image);
+
+  AssetEntry const *const sheet = AssetPack_find(pack, name);
+  if (sheet == NULL || sheet->kind != ASSET_KIND_RGBA32) {
+    SDL_SetError("no baked image %s", name);
+    return NULL;
+  }
+
+  SDL_Texture *const texture =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, (int)sheet->w, (int)sheet->h);
+  if (texture == NULL) {
+    return NULL;
+  }
+
+  if (!SDL_UpdateTexture(texture, NULL, AssetPack_data(pack, sheet), (int)sheet->pitch)) {
+    SDL_DestroyTexture(texture);
+    return NULL;
+  }
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+  SDL_SetTextureScaleMode(texture, SDL_SCALEMODE_NEAREST);
+
+  return texture;
+}
+
+/**
+ * Draws every shape with the atlas's first frame until told otherwise.
+ */
+void WellView_init(WellView *const view, Atlas const *const atlas, SDL_Texture *const texture) {
+  view->atlas = atlas;
+  view->texture = texture;
+  view->mino = RENDER_MINO_PIXELS;
+
+  for (size_t shape = 0; shape < TETROMINO_SHAPE_CNT; shape++) {
+    view->tint[shape] = (SDL_FColor){1.0f, 1.0f, 1.0f, 1.0f};
+    WellView_set_frame(view, (ETetrominoShape)shape, 0);
+  }
+}
+
+/**
+ * @param frame Index into the atlas's frames, a mino is the frame's top left RENDER_MINO_PIXELS square
+ */
+void WellView_set_frame(WellView *const view, ETetrominoShape const shape, uint8_t const frame) {
+  Atlas const *const atlas = view->atlas;
+  assert(frame < atlas->cnt && "atlas frame out of range");
+
+  AtlasFrame const *const f = &atlas->frames[frame];
+  float const w = (float)(f->w < RENDER_MINO_PIXELS ? f->w : RENDER_MINO_PIXELS);
+  float const h = (float)(f->h < RENDER_MINO_PIXELS ? f->h : RENDER_MINO_PIXELS);
+
+  view->frame[shape] = frame;
+  view->uv[shape] = (SDL_FRect){(float)f->x / atlas->w, (float)f->y / atlas->h, w / atlas->w, h / atlas->h};
+}
+
+static void _WellView_push_piece(WellView const *const view, SpriteBatch *const batch, Tetromino const *const t,
+                                 float const row_offset, SDL_FColor const color) {
+  MinoCoords const c = TetrominoWell_coords(t);
+
+  for (size_t m = 0; m < MINO_CNT; m++) {
+    if (t->mino_mask & (1 << m)) {
+      continue;
+    }
+
+    SDL_FRect const dst = {view->x + (float)c.coords[2 * m + 1] * view->mino,
+                           view->y + ((float)c.coords[2 * m] + row_offset) * view->mino, view->mino, view->mino};
+    SpriteBatch_push(batch, &dst, &view->uv[t->shape], color);
+  }
+}
+
+/**
+ * Fills batch with the locked minos of the selected rows, positioned relative to view.
+ *
+ * @param batch Cleared first, needs room for RENDER_STACK_QUADS of the well
+ * @param rows Bitset of the rows to include, a bit per row
+ */
+void WellView_build_stack(WellView const *const view, SpriteBatch *const batch, TetrominoWell const *const w,
+                          uint64_t const *const rows) {
+  SpriteBatch_clear(batch);
+
+  for (size_t i = 0; i < w->coll->cnt; i++) {
+    uint8_t cleared;
+    MinoCoords const c = TetrominoWell_locked_coords(w, i, &cleared);
+    uint8_t const shape = w->coll->shape[i];
+
+    for (size_t m = 0; m < MINO_CNT; m++) {
+      size_t const row = c.coords[2 * m];
+      if ((cleared & (1 << m)) || !(rows[row / 64] >> (row % 64) & 1)) {
+        continue;
+      }
+
+      SDL_FRect const dst = {view->x + (float)c.coords[2 * m + 1] * view->mino, view->y + (float)row * view->mino,
+                             view->mino, view->mino};
+      SpriteBatch_push(batch, &dst, &view->uv[shape], view->tint[shape]);
+    }
+  }
+}
+
+/**
+ * Fills batch with the ghost and active pieces, the ghost first so the active piece is drawn over it.
+ *
+ * @param batch Cleared first, needs room for RENDER_PIECE_QUADS
+ * @param alpha Fraction of the current tick elapsed, the active piece is drawn that far along its fall
+ */
+void WellView_build_pieces(WellView const *const view, SpriteBatch *const batch, GameState const *const state,
+                           float const alpha) {
+  SpriteBatch_clear(batch);
+
+  if (state->active == NULL || state->status == GAME_STATUS_OVER) {
+    return;
+  }
+
+  Tetromino ghost = *state->active;
+  while (!TetrominoWell_collision(state->well, &ghost, 1, 0)) {
+    Tetromino_translate(&ghost, 1, 0);
+  }
+
+  SDL_FColor faded = view->tint[ghost.shape];
+  faded.a *= RENDER_GHOST_ALPHA;
+  _WellView_push_piece(view, batch, &ghost, 0, faded);
+  _WellView_push_piece(view, batch, state->active, Game_fall_offset(state, alpha), view->tint[ghost.shape]);
+}
+
+/**
+ * Draws a table of min, average, 99th percentile and max milliseconds per frame phase with the debug text font.
+ */
+void FrameTimes_draw(FrameTimes const *const times, SDL_Renderer *const renderer, float const x, float const y) {
+  float const line = SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE + 2;
+
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0xC0);
+  SDL_FRect const panel = {x, y, 38 * SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE + 8, (FRAME_PHASE_CNT + 1) * line + 6};
+  SDL_RenderFillRect(renderer, &panel);
+
+  SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, SDL_ALPHA_OPAQUE);
+  char text[64];
+  SDL_snprintf(text, sizeof(text), "%-8s %6s %6s %6s %6s", "ms", "min", "avg", "p99", "max");
+  SDL_RenderDebugText(renderer, x + 4, y + 4, text);
+
+  for (size_t p = 0; p < FRAME_PHASE_CNT; p++) {
+    FrameStats const s = FrameTimes_stats(times, (EFramePhase)p);
+    SDL_snprintf(text, sizeof(text), "%-8s %6.2f %6.2f %6.2f %6.2f", FRAME_PHASE_NAMES[p], s.min / 1e6, s.avg / 1e6,
+                 s.p99 / 1e6, s.max / 1e6);
+    SDL_RenderDebugText(renderer, x + 4, y + 4 + (float)(p + 1) * line, text);
+  }
+}
+
+StackCache *StackCache_init(SDL_Renderer *const renderer, TetrominoWell const *const w, float const mino) {
+  StackCache *new = calloc(1, sizeof(StackCache));
+  new->target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                  (int)((float)w->cols * mino), (int)((float)w->rows * mino));
+  SDL_SetTextureBlendMode(new->target, SDL_BLENDMODE_BLEND);
+  new->batch = SpriteBatch_init(RENDER_STACK_QUADS(w->rows, w->cols));
+  new->rows = w->rows;
+  new->cols = w->cols;
+  new->words = w->words;
+  new->bits = calloc(w->rows * w->words, sizeof(WellWord));
+  new->row_id = calloc(w->rows, sizeof(uint32_t));
+  new->dirty = calloc((w->rows + 63) / 64, sizeof(uint64_t));
+
+  return new;
+}
+
+void StackCache_free(StackCache *cache) {
+  if (cache == NULL) {
+    return;
+  }
+
+  SDL_DestroyTexture(cache->target);
+  SpriteBatch_free(cache->batch);
+  free(cache->bits);
+  free(cache->row_id);
+  free(cache->dirty);
+  free(cache);
+}
+
+// Forces a full redraw, for when the target's contents were lost
+void StackCache_invalidate(StackCache *const cache) { cache->valid = false; }
+
+/**
+ * Brings the cached stack up to date with the well, redrawing only the rows that changed.
+ *
+ * @param view Supplies the sprites and mino size, its position is ignored as the target starts at the well's corner
+ * @return Rows redrawn, 0 in the steady state between locks
+ */
+size_t StackCache_update(StackCache *const cache, SDL_Renderer *const renderer, WellView const *const view,
+                         TetrominoWell const *const w) {
+  assert(w->rows == cache->rows && w->words == cache->words && "stack cache built for another well size");
+
+  size_t cnt = 0;
+  memset(cache->dirty, 0, sizeof(uint64_t) * ((cache->rows + 63) / 64));
+
+  for (size_t row = 0; row < cache->rows; row++) {
+    WellWord const *const cur = &w->bits[row * w->words];
+    WellWord *const prev = &cache->bits[row * w->words];
+
+    WellWord diff = 0;
+    for (size_t word = 0; word < w->words; word++) {
+      diff |= cur[word] ^ prev[word];
+      prev[word] = cur[word];
+    }
+
+    if (diff != 0 || w->row_id[row] != cache->row_id[row] || !cache->valid) {
+      cache->dirty[row / 64] |= (uint64_t)1 << (row % 64);
+      cache->row_id[row] = w->row_id[row];
+      cnt++;
+    }
+  }
+
+  if (cnt == 0) {
+    return 0;
+  }
+
+  WellView local = *view;
+  local.x = 0;
+  local.y = 0;
+  WellView_build_stack(&local, cache->batch, w, cache->dirty);
+
+  SDL_SetRenderTarget(renderer, cache->target);
+
+  // Dirty rows are wiped to transparent, not blended over, before their minos are drawn again
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_TRANSPARENT);
+  for (size_t row = 0; row < cache->rows; row++) {
+    if (cache->dirty[row / 64] >> (row % 64) & 1) {
+      SDL_FRect const strip = {0, (float)row * view->mino, (float)w->cols * view->mino, view->mino};
+      SDL_RenderFillRect(renderer, &strip);
+    }
+  }
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+  SpriteBatch_draw(cache->batch, renderer, view->texture);
+  SDL_SetRenderTarget(renderer, NULL);
+  cache->valid = true;
+
+  return cnt;
+}
+
+bool StackCache_draw(StackCache const *const cache, SDL_Renderer *const renderer, WellView const *const view) {
+  SDL_FRect const dst = {view->x, view->y, (float)cache->cols * view->mino, (float)cache->rows * view->mino};
+  return SDL_RenderTexture(renderer, cache->target, NULL, &dst);
+}
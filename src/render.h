@@ -0,0 +1,76 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "atlas.h"
+#include "frametime.h"
+#include "game.h"
+#include "pack.h"
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define RENDER_MINO_PIXELS 32
+// Every live locked mino fits in the well
+#define RENDER_STACK_QUADS(rows, cols) ((rows) * (cols))
+// The active piece and its ghost
+#define RENDER_PIECE_QUADS (2 * MINO_CNT)
+
+// Quads sharing one texture, submitted together with a single SDL_RenderGeometry call. The index buffer never
+// changes, so it is built once for the whole capacity.
+typedef struct {
+  SDL_Vertex *verts;
+  int *indices;
+  size_t cnt, cap;
+} SpriteBatch;
+
+// How a well is drawn: where, how large, and which atlas frame each shape uses
+typedef struct {
+  Atlas const *atlas;
+  SDL_Texture *texture;
+  uint8_t frame[TETROMINO_SHAPE_CNT];
+  // Normalised texture coordinates of a single mino of each shape, derived from frame
+  SDL_FRect uv[TETROMINO_SHAPE_CNT];
+  SDL_FColor tint[TETROMINO_SHAPE_CNT];
+  float x, y;
+  float mino;
+} WellView;
+
+// The locked stack kept in a render target. Rows are redrawn only when they change: their occupancy differs from the
+// snapshot taken at the last redraw, or their row id does, which catches rows shifted down by a clear onto an
+// identical occupancy.
+typedef struct {
+  SDL_Texture *target;
+  SpriteBatch *batch;
+  size_t rows, cols, words;
+  WellWord *bits;
+  uint32_t *row_id;
+  uint64_t *dirty;
+  bool valid;
+} StackCache;
+
+SpriteBatch *SpriteBatch_init(size_t const cap);
+void SpriteBatch_free(SpriteBatch *batch);
+void SpriteBatch_clear(SpriteBatch *const batch);
+void SpriteBatch_push(SpriteBatch *const batch, SDL_FRect const *const dst, SDL_FRect const *const uv,
+                      SDL_FColor const color);
+bool SpriteBatch_draw(SpriteBatch const *const batch, SDL_Renderer *const renderer, SDL_Texture *const texture);
+
+SDL_Texture *Atlas_texture(SDL_Renderer *const renderer, Atlas const *const atlas, AssetPack const *const pack);
+
+void WellView_init(WellView *const view, Atlas const *const atlas, SDL_Texture *const texture);
+void WellView_set_frame(WellView *const view, ETetrominoShape const shape, uint8_t const frame);
+void WellView_build_stack(WellView const *const view, SpriteBatch *const batch, TetrominoWell const *const w,
+                          uint64_t const *const rows);
+void WellView_build_pieces(WellView const *const view, SpriteBatch *const batch, GameState const *const state,
+                           float const alpha);
+
+void FrameTimes_draw(FrameTimes const *const times, SDL_Renderer *const renderer, float const x, float const y);
+
+StackCache *StackCache_init(SDL_Renderer *const renderer, TetrominoWell const *const w, float const mino);
+void StackCache_free(StackCache *cache);
+void StackCache_invalidate(StackCache *const cache);
+size_t StackCache_update(StackCache *const cache, SDL_Renderer *const renderer, WellView const *const view,
+                         TetrominoWell const *const w);
+bool StackCache_draw(StackCache const *const cache, SDL_Renderer *const renderer, WellView const *const view);
+
+#endif
@@ -0,0 +1,237 @@
+#include "replay.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void _Replay_put(uint8_t *const out, size_t const bytes, uint64_t const value) {
+  for (size_t i = 0; i < bytes; i++) {
+    out[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+static uint64_t _Replay_get(uint8_t const *const in, size_t const bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    value |= (uint64_t)in[i] << (8 * i);
+  }
+  return value;
+}
+
+static void _ReplayWriter_header(ReplayWriter const *const writer, GameState const *const state,
+                                 uint8_t header[REPLAY_HEADER_SIZE]) {
+  memset(header, 0, REPLAY_HEADER_SIZE);
+  memcpy(&header[REPLAY_OFFSET_MAGIC], REPLAY_MAGIC, 4);
+  _Replay_put(&header[REPLAY_OFFSET_VERSION], 2, REPLAY_VERSION);
+  _Replay_put(&header[REPLAY_OFFSET_ROWS], 2, state->well->rows);
+  _Replay_put(&header[REPLAY_OFFSET_COLS], 2, state->well->cols);
+  _Replay_put(&header[REPLAY_OFFSET_SEED], 8, writer->seed);
+  _Replay_put(&header[REPLAY_OFFSET_END_TICK], 8, state->tick);
+  _Replay_put(&header[REPLAY_OFFSET_EVENTS], 8, writer->events);
+  _Replay_put(&header[REPLAY_OFFSET_HASH], 8, state->well->hash);
+  _Replay_put(&header[REPLAY_OFFSET_LINES], 8, state->lines);
+}
+
+/**
+ * Starts recording a game.
+ *
+ * @param state Game just reset with seed, recording follows it tick by tick
+ * @param seed Seed the game was reset with
+ * @return Writer, NULL when the file cannot be created
+ */
+ReplayWriter *ReplayWriter_init(char const *const path, GameState const *const state, uint64_t const seed) {
+  assert(state->tick == 0 && "recording must start with a fresh game");
+
+  FILE *const file = fopen(path, "wb");
+  if (file == NULL) {
+    return NULL;
+  }
+
+  ReplayWriter *new = calloc(1, sizeof(ReplayWriter));
+  new->file = file;
+  new->seed = seed;
+
+  // Placeholder until the totals are known at close
+  uint8_t header[REPLAY_HEADER_SIZE];
+  _ReplayWriter_header(new, state, header);
+  fwrite(header, 1, sizeof(header), file);
+
+  return new;
+}
+
+/**
+ * Records the input of the tick just stepped, ticks without input cost nothing.
+ */
+void ReplayWriter_step(ReplayWriter *const writer, GameState const *const state, InputMask const input) {
+  if (input == INPUT_NONE || state->tick == writer->last_tick) {
+    return;
+  }
+
+  assert(input <= UINT8_MAX && "input masks are stored as one byte");
+
+  // LEB128: seven bits per byte, high bit set while more follow
+  uint8_t event[11];
+  size_t len = 0;
+  for (uint64_t delta = state->tick - writer->last_tick;; delta >>= 7) {
+    event[len++] = (uint8_t)(delta & 0x7F) | (delta > 0x7F ? 0x80 : 0);
+    if (delta <= 0x7F) {
+      break;
+    }
+  }
+  event[len++] = (uint8_t)input;
+
+  fwrite(event, 1, len, writer->file);
+  writer->last_tick = state->tick;
+  writer->events++;
+}
+
+/**
+ * Finishes the header with the game's end tick and outcome, and closes the file.
+ *
+ * @return False when anything failed to write
+ */
+bool ReplayWriter_close(ReplayWriter *writer, GameState const *const state) {
+  if (writer == NULL) {
+    return false;
+  }
+
+  uint8_t header[REPLAY_HEADER_SIZE];
+  _ReplayWriter_header(writer, state, header);
+
+  bool ok = !ferror(writer->file);
+  ok = ok && fseek(writer->file, 0, SEEK_SET) == 0;
+  ok = ok && fwrite(header, 1, sizeof(header), writer->file) == sizeof(header);
+  ok = fclose(writer->file) == 0 && ok;
+  free(writer);
+
+  return ok;
+}
+
+/**
+ * Maps a replay file and checks its header.
+ *
+ * @return Replay positioned at the first event, NULL when the file is missing, truncated or of an unknown version
+ */
+Replay *Replay_open(char const *const path) {
+  int const fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < REPLAY_HEADER_SIZE) {
+    close(fd);
+    return NULL;
+  }
+
+  void *const data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+
+  uint8_t const *const bytes = data;
+  uint16_t const version = (uint16_t)_Replay_get(&bytes[REPLAY_OFFSET_VERSION], 2);
+  if (memcmp(&bytes[REPLAY_OFFSET_MAGIC], REPLAY_MAGIC, 4) != 0 || version != REPLAY_VERSION) {
+    munmap(data, (size_t)st.st_size);
+    return NULL;
+  }
+
+  Replay *new = calloc(1, sizeof(Replay));
+  new->data = bytes;
+  new->size = (size_t)st.st_size;
+  new->version = version;
+  new->rows = (uint16_t)_Replay_get(&bytes[REPLAY_OFFSET_ROWS], 2);
+  new->cols = (uint16_t)_Replay_get(&bytes[REPLAY_OFFSET_COLS], 2);
+  new->seed = _Replay_get(&bytes[REPLAY_OFFSET_SEED], 8);
+  new->end_tick = _Replay_get(&bytes[REPLAY_OFFSET_END_TICK], 8);
+  new->events = _Replay_get(&bytes[REPLAY_OFFSET_EVENTS], 8);
+  new->hash = _Replay_get(&bytes[REPLAY_OFFSET_HASH], 8);
+  new->lines = _Replay_get(&bytes[REPLAY_OFFSET_LINES], 8);
+  Replay_rewind(new);
+
+  return new;
+}
+
+void Replay_close(Replay *replay) {
+  if (replay == NULL) {
+    return;
+  }
+
+  munmap((void *)replay->data, replay->size);
+  free(replay);
+}
+
+void Replay_rewind(Replay *const replay) {
+  replay->cursor = REPLAY_HEADER_SIZE;
+  replay->tick = 0;
+}
+
+/**
+ * Decodes the next event straight from the mapping.
+ *
+ * @param tick Receives the tick the input applies to
+ * @return False at the end of the events, or where they stop making sense
+ */
+bool Replay_next(Replay *const replay, uint64_t *const tick, InputMask *const input) {
+  uint64_t delta = 0;
+  size_t cursor = replay->cursor;
+
+  for (unsigned shift = 0;; shift += 7) {
+    if (cursor >= replay->size || shift > 63) {
+      return false;
+    }
+
+    uint8_t const byte = replay->data[cursor++];
+    delta |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      break;
+    }
+  }
+
+  if (cursor >= replay->size || delta == 0) {
+    return false;
+  }
+
+  replay->tick += delta;
+  *tick = replay->tick;
+  *input = replay->data[cursor++];
+  replay->cursor = cursor;
+
+  return true;
+}
+
+/**
+ * Plays a replay back as fast as the engine steps, no rendering or waiting.
+ *
+ * @param state Game to play into, reset with the replay's seed first
+ * @return Whether the game reached the recorded end tick with the recorded well and lines
+ */
+bool Replay_play(Replay *const replay, GameState *const state) {
+  if (replay->rows != state->well->rows || replay->cols != state->well->cols) {
+    return false;
+  }
+
+  GameState_reset(state, replay->seed);
+  Replay_rewind(replay);
+
+  uint64_t tick;
+  InputMask input;
+  while (Replay_next(replay, &tick, &input) && tick <= replay->end_tick) {
+    while (state->tick + 1 < tick && Game_step(state, INPUT_NONE) == GAME_STATUS_PLAYING) {
+      continue;
+    }
+    if (Game_step(state, input) == GAME_STATUS_OVER) {
+      break;
+    }
+  }
+
+  while (state->tick < replay->end_tick && Game_step(state, INPUT_NONE) == GAME_STATUS_PLAYING) {
+    continue;
+  }
+
+  return state->tick == replay->end_tick && state->well->hash == replay->hash && state->lines == replay->lines;
+}
@@ -0,0 +1,61 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// File layout, all integers little endian:
+//   header  REPLAY_HEADER_SIZE bytes, see the offsets below
+//   events  per tick with input: LEB128 ticks since the previous event, then the input mask as one byte
+#define REPLAY_MAGIC "CTRP"
+#define REPLAY_VERSION 1
+#define REPLAY_HEADER_SIZE 56
+
+#define REPLAY_OFFSET_MAGIC 0
+#define REPLAY_OFFSET_VERSION 4
+#define REPLAY_OFFSET_ROWS 6
+#define REPLAY_OFFSET_COLS 8
+#define REPLAY_OFFSET_SEED 16
+#define REPLAY_OFFSET_END_TICK 24
+#define REPLAY_OFFSET_EVENTS 32
+#define REPLAY_OFFSET_HASH 40
+#define REPLAY_OFFSET_LINES 48
+
+typedef struct {
+  FILE *file;
+  uint64_t seed;
+  uint64_t last_tick;
+  uint64_t events;
+} ReplayWriter;
+
+// A replay mapped read-only into memory, events are decoded in place
+typedef struct {
+  uint8_t const *data;
+  size_t size;
+  size_t cursor;
+  uint64_t tick;
+
+  uint16_t version;
+  uint16_t rows, cols;
+  uint64_t seed;
+  uint64_t end_tick;
+  uint64_t events;
+  // Well hash and lines at end_tick, to check playback against
+  uint64_t hash;
+  uint64_t lines;
+} Replay;
+
+ReplayWriter *ReplayWriter_init(char const *const path, GameState const *const state, uint64_t const seed);
+void ReplayWriter_step(ReplayWriter *const writer, GameState const *const state, InputMask const input);
+bool ReplayWriter_close(ReplayWriter *writer, GameState const *const state);
+
+Replay *Replay_open(char const *const path);
+void Replay_close(Replay *replay);
+bool Replay_next(Replay *const replay, uint64_t *const tick, InputMask *const input);
+void Replay_rewind(Replay *const replay);
+bool Replay_play(Replay *const replay, GameState *const state);
+
+#endif
@@ -0,0 +1,209 @@
+#include "scheduler.h"
+#include <assert.h>
+#include <sched.h>
+#include <stdlib.h>
+
+static void _SchedDeque_push(SchedDeque *const d, SchedTask *const task) {
+  long long const b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+  assert(b - atomic_load_explicit(&d->top, memory_order_acquire) < SCHED_DEQUE_CAP && "scheduler deque full");
+
+  atomic_store_explicit(&d->tasks[b & (SCHED_DEQUE_CAP - 1)], task, memory_order_relaxed);
+  // Publishes the task to thieves, who load bottom with acquire
+  atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+}
+
+static SchedTask *_SchedDeque_pop(SchedDeque *const d) {
+  long long const b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  long long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+  if (t > b) {
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return NULL;
+  }
+
+  SchedTask *task = atomic_load_explicit(&d->tasks[b & (SCHED_DEQUE_CAP - 1)], memory_order_relaxed);
+  if (t == b) {
+    // Last task, race the thieves for it
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+      task = NULL;
+    }
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+  }
+
+  return task;
+}
+
+static SchedTask *_SchedDeque_steal(SchedDeque *const d) {
+  long long t = atomic_load_explicit(&d->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  long long const b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+  if (t >= b) {
+    return NULL;
+  }
+
+  SchedTask *const task = atomic_load_explicit(&d->tasks[t & (SCHED_DEQUE_CAP - 1)], memory_order_relaxed);
+  if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+    return NULL;
+  }
+
+  return task;
+}
+
+static void _SchedTask_run(SchedWorker *const worker, SchedTask *const task) {
+  task->fn(worker, task->arg);
+  atomic_fetch_sub_explicit(&task->group->pending, 1, memory_order_release);
+}
+
+// Own tasks first, newest first for locality, then the oldest task of a random victim
+static SchedTask *_SchedWorker_find(SchedWorker *const worker) {
+  SchedTask *task = _SchedDeque_pop(&worker->deque);
+  if (task != NULL) {
+    return task;
+  }
+
+  Scheduler *const sched = worker->sched;
+  if (sched->workers_cnt < 2) {
+    return NULL;
+  }
+
+  uint64_t x = worker->rng;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  worker->rng = x;
+
+  size_t const first = (size_t)(x % sched->workers_cnt);
+  for (size_t i = 0; i < sched->workers_cnt; i++) {
+    size_t const victim = (first + i) % sched->workers_cnt;
+    if (victim != worker->id && (task = _SchedDeque_steal(&sched->workers[victim].deque)) != NULL) {
+      return task;
+    }
+  }
+
+  return NULL;
+}
+
+static void *_SchedWorker_loop(void *arg) {
+  SchedWorker *const worker = arg;
+  Scheduler *const sched = worker->sched;
+
+  for (;;) {
+    pthread_mutex_lock(&sched->lock);
+    while (!sched->quit && !atomic_load_explicit(&sched->running, memory_order_acquire)) {
+      pthread_cond_wait(&sched->wake, &sched->lock);
+    }
+    bool const quit = sched->quit;
+    pthread_mutex_unlock(&sched->lock);
+
+    if (quit) {
+      return NULL;
+    }
+
+    while (atomic_load_explicit(&sched->running, memory_order_acquire)) {
+      SchedTask *const task = _SchedWorker_find(worker);
+      if (task != NULL) {
+        _SchedTask_run(worker, task);
+      } else {
+        sched_yield();
+      }
+    }
+  }
+}
+
+/**
+ * @param threads Workers including the thread calling Scheduler_run, at least one
+ * @return NULL if a worker thread could not be started
+ */
+Scheduler *Scheduler_init(size_t const threads) {
+  assert(threads > 0 && "scheduler needs at least one worker");
+
+  Scheduler *new = calloc(1, sizeof(Scheduler));
+  new->workers_cnt = threads;
+  new->workers = aligned_alloc(CACHE_LINE_SIZE, sizeof(SchedWorker) * threads);
+  pthread_mutex_init(&new->lock, NULL);
+  pthread_cond_init(&new->wake, NULL);
+  atomic_init(&new->running, false);
+
+  for (size_t i = 0; i < threads; i++) {
+    SchedWorker *const worker = &new->workers[i];
+    atomic_init(&worker->deque.top, 0);
+    atomic_init(&worker->deque.bottom, 0);
+    worker->sched = new;
+    worker->id = i;
+    worker->rng = 0x9E3779B97F4A7C15ULL * (i + 1);
+  }
+
+  for (size_t i = 1; i < threads; i++) {
+    if (pthread_create(&new->workers[i].thread, NULL, _SchedWorker_loop, &new->workers[i]) != 0) {
+      // Only the workers already running are woken to quit and joined
+      new->workers_cnt = i;
+      Scheduler_free(new);
+      return NULL;
+    }
+  }
+
+  return new;
+}
+
+void Scheduler_free(Scheduler *sched) {
+  if (sched == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&sched->lock);
+  sched->quit = true;
+  pthread_cond_broadcast(&sched->wake);
+  pthread_mutex_unlock(&sched->lock);
+
+  for (size_t i = 1; i < sched->workers_cnt; i++) {
+    pthread_join(sched->workers[i].thread, NULL);
+  }
+
+  pthread_cond_destroy(&sched->wake);
+  pthread_mutex_destroy(&sched->lock);
+  free(sched->workers);
+  free(sched);
+}
+
+/**
+ * Runs root on the calling thread as worker 0, with the other workers stealing whatever it spawns.
+ *
+ * Only one thread may run a scheduler at a time. Root must wait for every group it spawns into before returning.
+ */
+void Scheduler_run(Scheduler *const sched, SchedFn const root, void *const arg) {
+  pthread_mutex_lock(&sched->lock);
+  atomic_store_explicit(&sched->running, true, memory_order_release);
+  pthread_cond_broadcast(&sched->wake);
+  pthread_mutex_unlock(&sched->lock);
+
+  root(&sched->workers[0], arg);
+
+  atomic_store_explicit(&sched->running, false, memory_order_release);
+}
+
+/**
+ * Queues fn(arg) on the worker's own deque, where idle workers can steal it.
+ *
+ * @param task Storage for the task, owned by the caller until the group has been waited on
+ */
+void Scheduler_spawn(SchedWorker *const worker, SchedGroup *const group, SchedTask *const task, SchedFn const fn,
+                     void *const arg) {
+  *task = (SchedTask){.fn = fn, .arg = arg, .group = group};
+  atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+  _SchedDeque_push(&worker->deque, task);
+}
+
+// Runs queued or stolen tasks until everything spawned into the group is done
+void Scheduler_wait(SchedWorker *const worker, SchedGroup *const group) {
+  while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+    SchedTask *const task = _SchedWorker_find(worker);
+    if (task != NULL) {
+      _SchedTask_run(worker, task);
+    } else {
+      sched_yield();
+    }
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "game.h"
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Tasks one worker can have queued at once, a power of two
+#define SCHED_DEQUE_CAP 4096
+
+struct Scheduler;
+struct SchedWorker;
+
+typedef void (*SchedFn)(struct SchedWorker *const worker, void *const arg);
+
+// Tasks still running in a fork-join scope
+typedef struct {
+  atomic_size_t pending;
+} SchedGroup;
+
+// Owned by whoever spawns it and must stay alive until its group is waited on, the scheduler never allocates
+typedef struct {
+  SchedFn fn;
+  void *arg;
+  SchedGroup *group;
+} SchedTask;
+
+// Chase-Lev deque: the owner pushes and pops at the bottom, thieves take from the top
+typedef struct {
+  alignas(CACHE_LINE_SIZE) atomic_llong top;
+  alignas(CACHE_LINE_SIZE) atomic_llong bottom;
+  _Atomic(SchedTask *) tasks[SCHED_DEQUE_CAP];
+} SchedDeque;
+
+typedef struct SchedWorker {
+  SchedDeque deque;
+  struct Scheduler *sched;
+  size_t id;
+  uint64_t rng;
+  pthread_t thread;
+} SchedWorker;
+
+typedef struct Scheduler {
+  // Worker 0 is whichever thread calls Scheduler_run, the rest are spawned threads
+  SchedWorker *workers;
+  size_t workers_cnt;
+
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  // Workers only look for work while a run is in progress and sleep otherwise
+  atomic_bool running;
+  bool quit;
+} Scheduler;
+
+Scheduler *Scheduler_init(size_t const threads);
+void Scheduler_free(Scheduler *sched);
+void Scheduler_run(Scheduler *const sched, SchedFn const root, void *const arg);
+void Scheduler_spawn(SchedWorker *const worker, SchedGroup *const group, SchedTask *const task, SchedFn const fn,
+                     void *const arg);
+void Scheduler_wait(SchedWorker *const worker, SchedGroup *const group);
+
+#endif
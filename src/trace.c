@@ -0,0 +1,224 @@
+#include "trace.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef TETRIS_TRACE
+
+// How long the flusher sleeps once it has caught up with the writers
+#define TRACE_FLUSH_NS 1000000L
+
+// One trace per process, recorded from any thread into a ring the flusher drains to a Chrome trace-event JSON file
+// that Perfetto or chrome://tracing open. Writers claim a slot by moving head and publish it through its seq, the
+// flusher is the only one to move tail.
+typedef struct {
+  TraceEvent *_Atomic events;
+  FILE *out;
+  char *buffer;
+  pthread_t flusher;
+  _Atomic bool running;
+  _Atomic uint64_t head;
+  _Atomic uint64_t tail;
+  _Atomic uint64_t dropped;
+  int pid;
+} _Trace;
+
+static _Trace trace = {0};
+static _Atomic uint32_t trace_tids = 0;
+static _Thread_local uint32_t trace_tid = 0;
+
+static void _Trace_write(TraceEvent const *const event, bool const first) {
+  static char const PHASES[] = {
+      [TRACE_PHASE_BEGIN] = 'B',
+      [TRACE_PHASE_END] = 'E',
+      [TRACE_PHASE_INSTANT] = 'i',
+      [TRACE_PHASE_ASYNC_BEGIN] = 'b',
+      [TRACE_PHASE_ASYNC_END] = 'e',
+      [TRACE_PHASE_THREAD_NAME] = 'M',
+  };
+
+  FILE *const out = trace.out;
+  fputs(first ? "\n" : ",\n", out);
+
+  if (event->phase == TRACE_PHASE_THREAD_NAME) {
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", trace.pid,
+            event->tid, event->name);
+    return;
+  }
+
+  // Microseconds with the nanoseconds kept as decimals, on the monotonic clock so other traces taken on it line up
+  fprintf(out, "{\"name\":\"%s\",\"cat\":\"tetris\",\"ph\":\"%c\",\"ts\":%llu.%03llu,\"pid\":%d,\"tid\":%u",
+          event->name, PHASES[event->phase], (unsigned long long)(event->ts_ns / 1000),
+          (unsigned long long)(event->ts_ns % 1000), trace.pid, event->tid);
+
+  switch (event->phase) {
+  case TRACE_PHASE_INSTANT:
+    fprintf(out, ",\"s\":\"t\",\"args\":{\"value\":%lld}}", (long long)event->arg);
+    break;
+  case TRACE_PHASE_ASYNC_BEGIN:
+  case TRACE_PHASE_ASYNC_END:
+    fprintf(out, ",\"id\":%lld}", (long long)event->arg);
+    break;
+  default:
+    fputc('}', out);
+    break;
+  }
+}
+
+static void *_Trace_flush(void *const arg) {
+  (void)arg;
+  struct timespec const pause = {.tv_sec = 0, .tv_nsec = TRACE_FLUSH_NS};
+  uint64_t tail = atomic_load_explicit(&trace.tail, memory_order_relaxed);
+
+  for (;;) {
+    // Read before draining, so the last pass after Trace_stop still sees every event published before it
+    bool const running = atomic_load_explicit(&trace.running, memory_order_acquire);
+
+    for (;;) {
+      TraceEvent const *const event = &trace.events[tail & (TRACE_CAP - 1)];
+      if (atomic_load_explicit(&event->seq, memory_order_acquire) != tail + 1) {
+        break;
+      }
+
+      _Trace_write(event, tail == 0);
+      // Hands the slot back to the writers only once it has been copied out
+      atomic_store_explicit(&trace.tail, ++tail, memory_order_release);
+    }
+
+    if (!running) {
+      return NULL;
+    }
+    nanosleep(&pause, NULL);
+  }
+}
+
+/**
+ * Starts recording events until Trace_stop, which writes out the rest of them.
+ *
+ * @param path Chrome trace-event JSON file to write, e.g. trace.json
+ * @return Whether the file opened and the flusher started, false as well if a trace is already running or the build
+ * has no TETRIS_TRACE
+ */
+bool Trace_start(char const *const path) {
+  if (atomic_load_explicit(&trace.events, memory_order_relaxed) != NULL) {
+    return false;
+  }
+
+  FILE *const out = fopen(path, "w");
+  if (out == NULL) {
+    return false;
+  }
+
+  TraceEvent *const events = calloc(TRACE_CAP, sizeof(TraceEvent));
+  // Touches every page now so recording never takes a page fault
+  memset(events, 0, TRACE_CAP * sizeof(TraceEvent));
+
+  // The flusher writes in large blocks, it never competes with the game for small writes
+  trace.buffer = malloc(1 << 20);
+  setvbuf(out, trace.buffer, _IOFBF, 1 << 20);
+  fputs("{\"traceEvents\":[", out);
+
+  trace.out = out;
+  trace.pid = (int)getpid();
+  atomic_store_explicit(&trace.head, 0, memory_order_relaxed);
+  atomic_store_explicit(&trace.tail, 0, memory_order_relaxed);
+  atomic_store_explicit(&trace.dropped, 0, memory_order_relaxed);
+  atomic_store_explicit(&trace.running, true, memory_order_relaxed);
+  atomic_store_explicit(&trace.events, events, memory_order_release);
+
+  if (pthread_create(&trace.flusher, NULL, _Trace_flush, NULL) != 0) {
+    atomic_store_explicit(&trace.events, NULL, memory_order_relaxed);
+    fclose(out);
+    free(trace.buffer);
+    free(events);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Waits for the flusher to write out every event and closes the file. Threads still recording must be done first.
+ */
+void Trace_stop(void) {
+  TraceEvent *const events = atomic_load_explicit(&trace.events, memory_order_relaxed);
+  if (events == NULL) {
+    return;
+  }
+
+  atomic_store_explicit(&trace.running, false, memory_order_release);
+  pthread_join(trace.flusher, NULL);
+  atomic_store_explicit(&trace.events, NULL, memory_order_relaxed);
+
+  fprintf(trace.out, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":\"%llu\"}}\n",
+          (unsigned long long)atomic_load_explicit(&trace.dropped, memory_order_relaxed));
+  fclose(trace.out);
+  free(trace.buffer);
+  free(events);
+}
+
+/**
+ * Records one event, or nothing when no trace is running. Never blocks and never allocates, an event the flusher has
+ * no room for yet is dropped and counted instead.
+ *
+ * @param name String literal, only its pointer is kept
+ * @param arg Value of instant events, id of async ones, ignored by the others
+ */
+void Trace_event(ETracePhase const phase, char const *const name, int64_t const arg) {
+  TraceEvent *const events = atomic_load_explicit(&trace.events, memory_order_relaxed);
+  if (events == NULL) {
+    return;
+  }
+  assert(phase <= TRACE_PHASE_THREAD_NAME && "unknown trace phase");
+
+  if (trace_tid == 0) {
+    trace_tid = atomic_fetch_add_explicit(&trace_tids, 1, memory_order_relaxed) + 1;
+  }
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  uint64_t head = atomic_load_explicit(&trace.head, memory_order_relaxed);
+  do {
+    if (head - atomic_load_explicit(&trace.tail, memory_order_acquire) >= TRACE_CAP) {
+      atomic_fetch_add_explicit(&trace.dropped, 1, memory_order_relaxed);
+      return;
+    }
+  } while (!atomic_compare_exchange_weak_explicit(&trace.head, &head, head + 1, memory_order_relaxed,
+                                                  memory_order_relaxed));
+
+  TraceEvent *const event = &events[head & (TRACE_CAP - 1)];
+  event->ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+  event->name = name;
+  event->arg = arg;
+  event->tid = trace_tid;
+  event->phase = (uint8_t)phase;
+  atomic_store_explicit(&event->seq, head + 1, memory_order_release);
+}
+
+// Events lost to a full buffer since the trace started
+uint64_t Trace_dropped(void) { return atomic_load_explicit(&trace.dropped, memory_order_relaxed); }
+
+#else
+
+// Without TETRIS_TRACE no trace ever starts, so --trace opens no file and starts no flusher
+bool Trace_start(char const *const path) {
+  (void)path;
+  return false;
+}
+
+void Trace_stop(void) {}
+
+void Trace_event(ETracePhase const phase, char const *const name, int64_t const arg) {
+  (void)phase;
+  (void)name;
+  (void)arg;
+}
+
+uint64_t Trace_dropped(void) { return 0; }
+
+#endif
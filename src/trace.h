@@ -0,0 +1,55 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Events held until the flusher writes them out, a power of two. Writers drop events rather than wait once it is full.
+#define TRACE_CAP (1 << 16)
+
+typedef enum {
+  TRACE_PHASE_BEGIN,
+  TRACE_PHASE_END,
+  TRACE_PHASE_INSTANT,
+  TRACE_PHASE_ASYNC_BEGIN,
+  TRACE_PHASE_ASYNC_END,
+  // Names the calling thread, the name is the thread's
+  TRACE_PHASE_THREAD_NAME,
+} ETracePhase;
+
+// Names must be string literals or otherwise outlive the trace, only the pointer is recorded
+typedef struct {
+  // Sequence number of the write plus one, published last so the flusher never reads a half written event
+  _Atomic uint64_t seq;
+  uint64_t ts_ns;
+  char const *name;
+  int64_t arg;
+  uint32_t tid;
+  uint8_t phase;
+} TraceEvent;
+
+bool Trace_start(char const *const path);
+void Trace_stop(void);
+void Trace_event(ETracePhase const phase, char const *const name, int64_t const arg);
+uint64_t Trace_dropped(void);
+
+// Only builds configured with TETRIS_TRACE record anything, otherwise the macros expand to nothing and their arguments
+// are never evaluated.
+#ifdef TETRIS_TRACE
+#define TRACE_BEGIN(name) Trace_event(TRACE_PHASE_BEGIN, (name), 0)
+#define TRACE_END(name) Trace_event(TRACE_PHASE_END, (name), 0)
+#define TRACE_INSTANT(name, arg) Trace_event(TRACE_PHASE_INSTANT, (name), (arg))
+#define TRACE_ASYNC_BEGIN(name, id) Trace_event(TRACE_PHASE_ASYNC_BEGIN, (name), (id))
+#define TRACE_ASYNC_END(name, id) Trace_event(TRACE_PHASE_ASYNC_END, (name), (id))
+#define TRACE_THREAD_NAME(name) Trace_event(TRACE_PHASE_THREAD_NAME, (name), 0)
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name, arg) ((void)0)
+#define TRACE_ASYNC_BEGIN(name, id) ((void)0)
+#define TRACE_ASYNC_END(name, id) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif
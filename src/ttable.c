@@ -0,0 +1,60 @@
+#include "ttable.h"
+#include "game.h"
+#include <assert.h>
+#include <stdlib.h>
+
+/**
+ * @param log2_slots Table holds 1 << log2_slots entries of 16 bytes
+ */
+TransTable *TransTable_init(size_t const log2_slots) {
+  assert(log2_slots > 0 && log2_slots < 40 && "transposition table size out of range");
+
+  TransTable *new = calloc(1, sizeof(TransTable));
+  size_t const cnt = (size_t)1 << log2_slots;
+  new->slots = aligned_alloc(CACHE_LINE_SIZE, sizeof(TransSlot) * cnt);
+  new->mask = cnt - 1;
+  TransTable_clear(new);
+
+  return new;
+}
+
+void TransTable_free(TransTable *tt) {
+  if (tt == NULL) {
+    return;
+  }
+
+  free(tt->slots);
+  free(tt);
+}
+
+// Not safe against concurrent probes or stores
+void TransTable_clear(TransTable *const tt) {
+  for (size_t i = 0; i <= tt->mask; i++) {
+    atomic_init(&tt->slots[i].check, 0);
+    atomic_init(&tt->slots[i].data, 0);
+  }
+}
+
+/**
+ * @param data Receives the stored data when the key is found
+ * @return Whether the key was found
+ */
+bool TransTable_probe(TransTable const *const tt, uint64_t const key, uint64_t *const data) {
+  TransSlot *const slot = &tt->slots[key & tt->mask];
+  uint64_t const d = atomic_load_explicit(&slot->data, memory_order_relaxed);
+  uint64_t const check = atomic_load_explicit(&slot->check, memory_order_relaxed);
+
+  // Key 0 would match an empty slot
+  if ((check ^ d) != key || key == 0) {
+    return false;
+  }
+
+  *data = d;
+  return true;
+}
+
+void TransTable_store(TransTable *const tt, uint64_t const key, uint64_t const data) {
+  TransSlot *const slot = &tt->slots[key & tt->mask];
+  atomic_store_explicit(&slot->check, key ^ data, memory_order_relaxed);
+  atomic_store_explicit(&slot->data, data, memory_order_relaxed);
+}
@@ -0,0 +1,27 @@
+#ifndef TTABLE_H
+#define TTABLE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The key is stored XORed with the data, so a slot torn by two racing writers no longer matches either key
+typedef struct {
+  _Atomic uint64_t check;
+  _Atomic uint64_t data;
+} TransSlot;
+
+// Fixed-size, lock-free table from 64 bit position hashes to 64 bits of data, newer entries replace older ones
+typedef struct {
+  TransSlot *slots;
+  size_t mask;
+} TransTable;
+
+TransTable *TransTable_init(size_t const log2_slots);
+void TransTable_free(TransTable *tt);
+void TransTable_clear(TransTable *const tt);
+bool TransTable_probe(TransTable const *const tt, uint64_t const key, uint64_t *const data);
+void TransTable_store(TransTable *const tt, uint64_t const key, uint64_t const data);
+
+#endif
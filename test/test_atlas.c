@@ -0,0 +1,109 @@
+#include "atlas.c"
+#include "atlas.h"
+#include "cmake_variables.h"
+#include "unity.h"
+#include <string.h>
+
+static Atlas ATLAS;
+
+void setUp(void) { memset(&ATLAS, 0xAB, sizeof(ATLAS)); }
+
+void tearDown(void) {}
+
+// Trimmed copy of assets/pixel_at_time.json
+static char const HASH_EXPORT[] = "{ \"frames\": {\n"
+                                  "   \"pixel_at_time.aseprite\": {\n"
+                                  "    \"frame\": { \"x\": 0, \"y\": 0, \"w\": 256, \"h\": 256 },\n"
+                                  "    \"rotated\": false,\n"
+                                  "    \"trimmed\": false,\n"
+                                  "    \"spriteSourceSize\": { \"x\": 0, \"y\": 0, \"w\": 256, \"h\": 256 },\n"
+                                  "    \"sourceSize\": { \"w\": 256, \"h\": 256 },\n"
+                                  "    \"duration\": 100\n"
+                                  "   }\n"
+                                  " },\n"
+                                  " \"meta\": {\n"
+                                  "  \"app\": \"http://www.aseprite.org/\",\n"
+                                  "  \"image\": \"pixel_at_time.png\",\n"
+                                  "  \"size\": { \"w\": 256, \"h\": 256 },\n"
+                                  "  \"scale\": \"1\",\n"
+                                  "  \"frameTags\": [\n  ],\n"
+                                  "  \"layers\": [\n"
+                                  "   { \"name\": \"Layer 1\", \"opacity\": 255, \"blendMode\": \"normal\" }\n"
+                                  "  ]\n"
+                                  " }\n"
+                                  "}\n";
+
+void test_atlas_parses_hash_export(void) {
+  TEST_ASSERT_TRUE(Atlas_parse(&ATLAS, HASH_EXPORT, strlen(HASH_EXPORT)));
+
+  TEST_ASSERT_EQUAL_size_t(1, ATLAS.cnt);
+  TEST_ASSERT_EQUAL_UINT(256, ATLAS.w);
+  TEST_ASSERT_EQUAL_UINT(256, ATLAS.h);
+  TEST_ASSERT_EQUAL_STRING("pixel_at_time.png", ATLAS.image);
+
+  AtlasFrame const f = ATLAS.frames[0];
+  TEST_ASSERT_EQUAL_UINT(0, f.x);
+  TEST_ASSERT_EQUAL_UINT(0, f.y);
+  TEST_ASSERT_EQUAL_UINT(256, f.w);
+  TEST_ASSERT_EQUAL_UINT(256, f.h);
+  TEST_ASSERT_EQUAL_UINT(256, f.source_w);
+  TEST_ASSERT_EQUAL_UINT(256, f.source_h);
+  TEST_ASSERT_EQUAL_UINT(100, f.duration_ms);
+}
+
+void test_atlas_parses_array_export(void) {
+  static char const json[] =
+      "{\"frames\":[{\"filename\":\"a 0\",\"frame\":{\"x\":0,\"y\":0,\"w\":32,\"h\":32},\"duration\":80,"
+      "\"sourceSize\":{\"w\":32,\"h\":32}},{\"filename\":\"a \\\"1\\\"\",\"frame\":{\"x\":32,\"y\":0,\"w\":32,\"h\":30},"
+      "\"sourceSize\":{\"w\":32,\"h\":32},\"duration\":120}],\"meta\":{\"size\":{\"w\":64,\"h\":32},"
+      "\"image\":\"a.png\",\"scale\":1.5}}";
+
+  TEST_ASSERT_TRUE(Atlas_parse(&ATLAS, json, strlen(json)));
+
+  TEST_ASSERT_EQUAL_size_t(2, ATLAS.cnt);
+  TEST_ASSERT_EQUAL_UINT(32, ATLAS.frames[1].x);
+  TEST_ASSERT_EQUAL_UINT(30, ATLAS.frames[1].h);
+  TEST_ASSERT_EQUAL_UINT(32, ATLAS.frames[1].source_h);
+  TEST_ASSERT_EQUAL_UINT(80, ATLAS.frames[0].duration_ms);
+  TEST_ASSERT_EQUAL_UINT(120, ATLAS.frames[1].duration_ms);
+}
+
+void test_atlas_rejects_bad_exports(void) {
+  static char const *const bad[] = {
+      "",
+      "{\"frames\":{}}",
+      // Truncated inside a name, and a name missing its opening quote
+      "{\"frames\":{\"a",
+      "{\"frames\":{a\":{}}}",
+      // Truncated mid-frame
+      "{\"frames\":{\"a\":{\"frame\":{\"x\":0,\"y\":0,\"w\":",
+      // Frame outside the sheet
+      "{\"frames\":[{\"frame\":{\"x\":16,\"y\":0,\"w\":32,\"h\":32}}],\"meta\":{\"size\":{\"w\":32,\"h\":32}}}",
+      "{\"frames\":[{\"frame\":{\"x\":0,\"y\":0,\"w\":32,\"h\":32}}] \"meta\":{}}",
+  };
+
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    TEST_ASSERT_FALSE_MESSAGE(Atlas_parse(&ATLAS, bad[i], strlen(bad[i])), bad[i]);
+  }
+}
+
+void test_atlas_rejects_too_many_frames(void) {
+  static char json[ATLAS_MAX_FRAMES * 64 + 128];
+  size_t len = (size_t)sprintf(json, "{\"frames\":[");
+  for (size_t i = 0; i <= ATLAS_MAX_FRAMES; i++) {
+    len += (size_t)sprintf(&json[len], "%s{\"frame\":{\"x\":0,\"y\":0,\"w\":1,\"h\":1}}", i ? "," : "");
+  }
+  len += (size_t)sprintf(&json[len], "],\"meta\":{\"size\":{\"w\":1,\"h\":1}}}");
+
+  TEST_ASSERT_FALSE(Atlas_parse(&ATLAS, json, len));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_atlas_parses_hash_export);
+  RUN_TEST(test_atlas_parses_array_export);
+  RUN_TEST(test_atlas_rejects_bad_exports);
+  RUN_TEST(test_atlas_rejects_too_many_frames);
+  return UNITY_END();
+}
@@ -0,0 +1,242 @@
+#include "bag.c"
+#include "bag.h"
+#include "bot.c"
+#include "bot.h"
+#include "cmake_variables.h"
+#include "collide.c"
+#include "eval.c"
+#include "game.c"
+#include "game.h"
+#include "movegen.c"
+#include "scheduler.c"
+#include "scheduler.h"
+#include "ttable.c"
+#include "ttable.h"
+#include "unity.h"
+#include <stdlib.h>
+
+#define SEED 0xC0FFEE
+#define FANOUT 32
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+typedef struct {
+  atomic_size_t *ran;
+  size_t depth;
+  SchedTask tasks[FANOUT];
+} _th_Node;
+
+static void _th_node(SchedWorker *const worker, void *const arg) {
+  _th_Node *const node = arg;
+  atomic_fetch_add(node->ran, 1);
+
+  if (node->depth == 0) {
+    return;
+  }
+
+  // Children live on this task's stack, which stays put until the group is done
+  _th_Node children[FANOUT];
+  SchedGroup group = {0};
+  for (size_t i = 0; i < FANOUT; i++) {
+    children[i] = (_th_Node){.ran = node->ran, .depth = node->depth - 1};
+    Scheduler_spawn(worker, &group, &node->tasks[i], _th_node, &children[i]);
+  }
+  Scheduler_wait(worker, &group);
+}
+
+void test_scheduler_runs_nested_tasks(void) {
+  Scheduler *const sched = Scheduler_init(4);
+  atomic_size_t ran = 0;
+
+  for (size_t run = 0; run < 3; run++) {
+    atomic_store(&ran, 0);
+    _th_Node root = {.ran = &ran, .depth = 2};
+    Scheduler_run(sched, _th_node, &root);
+    TEST_ASSERT_EQUAL_UINT(1 + FANOUT + FANOUT * FANOUT, atomic_load(&ran));
+  }
+
+  Scheduler_free(sched);
+}
+
+void test_bot_plan_independent_of_threads(void) {
+  GameState *const state = GameState_init(SEED);
+  Game_step(state, INPUT_NONE);
+
+  BotConfig cfg = BOT_CONFIG_DEFAULT;
+  cfg.depth = 2;
+  cfg.beam = 4;
+  cfg.threads = 1;
+  Bot *const single = Bot_init(&cfg);
+  cfg.threads = 4;
+  Bot *const multi = Bot_init(&cfg);
+
+  for (size_t piece = 0; piece < 10; piece++) {
+    Placement a, b;
+    TEST_ASSERT_TRUE(Bot_plan(single, state, &a));
+    TEST_ASSERT_TRUE(Bot_plan(multi, state, &b));
+    TEST_ASSERT_EQUAL_INT(a.row0, b.row0);
+    TEST_ASSERT_EQUAL_INT(a.col0, b.col0);
+    TEST_ASSERT_EQUAL_INT(a.rotation, b.rotation);
+
+    uint64_t const pieces = state->pieces;
+    while (state->pieces == pieces || state->active == NULL) {
+      Game_step(state, Bot_input(single, state));
+    }
+  }
+
+  Bot_free(single);
+  Bot_free(multi);
+  GameState_free(state);
+}
+
+void test_bot_clears_lines(void) {
+  GameState *const state = GameState_init(SEED);
+  BotConfig cfg = BOT_CONFIG_DEFAULT;
+  cfg.depth = 2;
+  cfg.beam = 4;
+  cfg.threads = 2;
+  Bot *const bot = Bot_init(&cfg);
+
+  while (state->pieces < 100 && Game_step(state, Bot_input(bot, state)) == GAME_STATUS_PLAYING) {
+    continue;
+  }
+
+  TEST_ASSERT_EQUAL_INT(GAME_STATUS_PLAYING, state->status);
+  // 100 pieces are 40 lines worth of minos, anything decent clears most of them
+  TEST_ASSERT_GREATER_OR_EQUAL(30, state->lines);
+
+  Bot_free(bot);
+  GameState_free(state);
+}
+
+void test_bot_replans_after_reset(void) {
+  GameState *const state = GameState_init(SEED);
+  BotConfig cfg = BOT_CONFIG_DEFAULT;
+  cfg.depth = 2;
+  cfg.beam = 4;
+  cfg.threads = 1;
+  Bot *const bot = Bot_init(&cfg);
+
+  Game_step(state, INPUT_NONE);
+  Bot_input(bot, state);
+  TEST_ASSERT_EQUAL_UINT64(1, bot->piece);
+
+  // The next game's first piece is piece 1 again, on another board
+  GameState_reset(state, SEED + 1);
+  Bot_reset(bot);
+  TEST_ASSERT_FALSE(bot->planned);
+  Game_step(state, INPUT_NONE);
+  Bot_input(bot, state);
+  TEST_ASSERT_TRUE(bot->planned);
+  Placement const target = bot->target;
+
+  Placement expected;
+  TEST_ASSERT_TRUE(Bot_plan(bot, state, &expected));
+  TEST_ASSERT_EQUAL_INT(expected.row0, target.row0);
+  TEST_ASSERT_EQUAL_INT(expected.col0, target.col0);
+  TEST_ASSERT_EQUAL_UINT(expected.rotation, target.rotation);
+
+  Bot_free(bot);
+  GameState_free(state);
+}
+
+void test_bot_searches_only_the_preview(void) {
+  GameState *const state = GameState_init(SEED);
+  BotConfig cfg = BOT_CONFIG_DEFAULT;
+  cfg.depth = 3;
+  cfg.beam = 4;
+  cfg.threads = 1;
+  Bot *const bot = Bot_init(&cfg);
+  Game_step(state, INPUT_NONE);
+  Placement best;
+
+  TEST_ASSERT_TRUE(Bot_plan(bot, state, &best));
+  TEST_ASSERT_EQUAL_size_t(3, bot->depth);
+
+  state->preview = 1;
+  TEST_ASSERT_TRUE(Bot_plan(bot, state, &best));
+  TEST_ASSERT_EQUAL_size_t(2, bot->depth);
+
+  state->preview = 0;
+  TEST_ASSERT_TRUE(Bot_plan(bot, state, &best));
+  TEST_ASSERT_EQUAL_size_t(1, bot->depth);
+
+  Bot_free(bot);
+  GameState_free(state);
+}
+
+void test_ttable_probe_and_replace(void) {
+  TransTable *const tt = TransTable_init(4);
+  uint64_t data = 0;
+
+  TEST_ASSERT_FALSE(TransTable_probe(tt, 0x1234, &data));
+  TransTable_store(tt, 0x1234, 42);
+  TEST_ASSERT_TRUE(TransTable_probe(tt, 0x1234, &data));
+  TEST_ASSERT_EQUAL_UINT64(42, data);
+
+  // Same slot, different key: the newer entry wins and the old key misses
+  TransTable_store(tt, 0x1234 + 16, 7);
+  TEST_ASSERT_FALSE(TransTable_probe(tt, 0x1234, &data));
+  TEST_ASSERT_TRUE(TransTable_probe(tt, 0x1234 + 16, &data));
+  TEST_ASSERT_EQUAL_UINT64(7, data);
+
+  TransTable_clear(tt);
+  TEST_ASSERT_FALSE(TransTable_probe(tt, 0x1234 + 16, &data));
+  TransTable_free(tt);
+}
+
+void test_bot_ttable_saves_evals_not_quality(void) {
+  BotConfig cfg = BOT_CONFIG_DEFAULT;
+  cfg.depth = 3;
+  cfg.beam = 4;
+  cfg.threads = 2;
+  cfg.tt_log2 = 0;
+  Bot *const plain = Bot_init(&cfg);
+  cfg.tt_log2 = 16;
+  Bot *const cached = Bot_init(&cfg);
+
+  GameState *const state = GameState_init(SEED);
+  Game_step(state, INPUT_NONE);
+  // The plain bot also drives the game, only count the plans made here
+  uint64_t plain_evals = 0;
+  for (size_t piece = 0; piece < 10; piece++) {
+    Placement a, b;
+    uint64_t const before = Bot_stats(plain).evals;
+    TEST_ASSERT_TRUE(Bot_plan(plain, state, &a));
+    plain_evals += Bot_stats(plain).evals - before;
+    TEST_ASSERT_TRUE(Bot_plan(cached, state, &b));
+    TEST_ASSERT_EQUAL_INT(a.row0, b.row0);
+    TEST_ASSERT_EQUAL_INT(a.col0, b.col0);
+    TEST_ASSERT_EQUAL_INT(a.rotation, b.rotation);
+
+    uint64_t const pieces = state->pieces;
+    while (state->pieces == pieces || state->active == NULL) {
+      Game_step(state, Bot_input(plain, state));
+    }
+  }
+
+  // Same nodes searched, but every plan revisits boards the previous one looked at a level deeper
+  BotStats const c = Bot_stats(cached);
+  TEST_ASSERT_EQUAL_UINT64(0, Bot_stats(plain).tt_hits);
+  TEST_ASSERT_EQUAL_UINT64(plain_evals, c.evals + c.tt_hits);
+  TEST_ASSERT_GREATER_THAN(0, c.tt_hits);
+  TEST_ASSERT_LESS_THAN(plain_evals, c.evals);
+
+  GameState_free(state);
+  Bot_free(plain);
+  Bot_free(cached);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_scheduler_runs_nested_tasks);
+  RUN_TEST(test_bot_plan_independent_of_threads);
+  RUN_TEST(test_bot_clears_lines);
+  RUN_TEST(test_bot_replans_after_reset);
+  RUN_TEST(test_bot_searches_only_the_preview);
+  RUN_TEST(test_ttable_probe_and_replace);
+  RUN_TEST(test_bot_ttable_saves_evals_not_quality);
+  return UNITY_END();
+}
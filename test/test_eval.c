@@ -0,0 +1,167 @@
+#include "bag.c"
+#include "bag.h"
+#include "cmake_variables.h"
+#include "eval.c"
+#include "eval.h"
+#include "game.c"
+#include "game.h"
+#include "unity.h"
+#include <stdlib.h>
+
+static TetrominoWell *WELL = NULL;
+
+void setUp(void) { WELL = TetrominoWell_init(WELL_ROWS, WELL_COLS); }
+
+void tearDown(void) {
+  TetrominoWell_free(WELL);
+  WELL = NULL;
+}
+
+// Straightforward per-cell version of every feature, to check the bit tricks against
+EvalFeatures _th_features(TetrominoWell const *const w) {
+  EvalFeatures f = {0};
+  size_t top[64];
+
+  for (size_t col = 0; col < w->cols; col++) {
+    top[col] = w->rows;
+    for (size_t row = w->rows; row-- > 0;) {
+      if (TetrominoWell_occupied(w, row, col)) {
+        top[col] = row;
+      }
+    }
+    f.aggregate_height += (int32_t)(w->rows - top[col]);
+
+    bool prev = false;
+    int32_t depth = 0;
+    for (size_t row = 0; row < w->rows; row++) {
+      bool const filled = TetrominoWell_occupied(w, row, col);
+      f.holes += row > top[col] && !filled;
+      f.col_transitions += filled != prev;
+      prev = filled;
+
+      bool const left = col == 0 || TetrominoWell_occupied(w, row, col - 1);
+      bool const right = col + 1 == w->cols || TetrominoWell_occupied(w, row, col + 1);
+      depth = row < top[col] && left && right ? depth + 1 : 0;
+      f.well_depths += depth;
+    }
+    f.col_transitions += !prev;
+  }
+
+  for (size_t col = 0; col + 1 < w->cols; col++) {
+    f.bumpiness += (int32_t)(top[col] > top[col + 1] ? top[col] - top[col + 1] : top[col + 1] - top[col]);
+  }
+
+  for (size_t row = 0; row < w->rows; row++) {
+    bool prev = true;
+    for (size_t col = 0; col < w->cols; col++) {
+      bool const filled = TetrominoWell_occupied(w, row, col);
+      f.row_transitions += filled != prev;
+      prev = filled;
+    }
+    f.row_transitions += !prev;
+  }
+
+  return f;
+}
+
+void _th_assert_features(EvalFeatures const expected, EvalFeatures const actual) {
+  TEST_ASSERT_EQUAL_INT32_MESSAGE(expected.aggregate_height, actual.aggregate_height, "aggregate height");
+  TEST_ASSERT_EQUAL_INT32_MESSAGE(expected.holes, actual.holes, "holes");
+  TEST_ASSERT_EQUAL_INT32_MESSAGE(expected.bumpiness, actual.bumpiness, "bumpiness");
+  TEST_ASSERT_EQUAL_INT32_MESSAGE(expected.row_transitions, actual.row_transitions, "row transitions");
+  TEST_ASSERT_EQUAL_INT32_MESSAGE(expected.col_transitions, actual.col_transitions, "col transitions");
+  TEST_ASSERT_EQUAL_INT32_MESSAGE(expected.well_depths, actual.well_depths, "well depths");
+  TEST_ASSERT_EQUAL_INT32(0, actual.lines);
+}
+
+void test_eval_well_depths_are_cumulative(void) {
+  // Column 2 three deep between columns 1 and 3, column 0 two deep against the wall
+  //   row 17: . X . X
+  //   row 18: . X . X
+  //   row 19: X X . X
+  TetrominoWell *const w = TetrominoWell_init(WELL_ROWS, 4);
+  for (size_t row = 17; row < WELL_ROWS; row++) {
+    TetrominoWell_fill(w, row, 1);
+    TetrominoWell_fill(w, row, 3);
+  }
+  TetrominoWell_fill(w, 19, 0);
+
+  EvalFeatures const f = TetrominoWell_features(w);
+  TEST_ASSERT_EQUAL_INT32((1 + 2 + 3) + (1 + 2), f.well_depths);
+  _th_assert_features(_th_features(w), f);
+  TetrominoWell_free(w);
+}
+
+void test_eval_empty_well(void) {
+  EvalFeatures const f = TetrominoWell_features(WELL);
+  _th_assert_features((EvalFeatures){.row_transitions = 2 * WELL_ROWS, .col_transitions = WELL_COLS}, f);
+}
+
+void test_eval_hand_built_well(void) {
+  // Column 0 two high with a hole under it, column 1 one high, a two deep well in column 2, column 3 three high
+  //   row 17: X . . X
+  //   row 18: . . . X
+  //   row 19: X X . X
+  TetrominoWell *const w = TetrominoWell_init(WELL_ROWS, 4);
+  TetrominoWell_fill(w, 17, 0);
+  TetrominoWell_fill(w, 19, 0);
+  TetrominoWell_fill(w, 19, 1);
+  TetrominoWell_fill(w, 17, 3);
+  TetrominoWell_fill(w, 18, 3);
+  TetrominoWell_fill(w, 19, 3);
+
+  EvalFeatures const f = TetrominoWell_features(w);
+  TEST_ASSERT_EQUAL_INT32(3 + 1 + 0 + 3, f.aggregate_height);
+  TEST_ASSERT_EQUAL_INT32(1, f.holes);
+  TEST_ASSERT_EQUAL_INT32(2 + 1 + 3, f.bumpiness);
+  // A well cell needs both neighbours filled: column 2 on row 19 only, column 1 on row 18 has an empty right side
+  TEST_ASSERT_EQUAL_INT32(1, f.well_depths);
+  _th_assert_features(_th_features(w), f);
+
+  TetrominoWell_free(w);
+}
+
+void test_eval_matches_per_cell_features(void) {
+  size_t const widths[] = {WELL_COLS, 31, 40};
+
+  srand(12);
+  for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+    TetrominoWell *const w = TetrominoWell_init(WELL_ROWS, widths[i]);
+
+    for (size_t round = 0; round < 50; round++) {
+      TetrominoWell_reset(w);
+      size_t const from = (size_t)rand() % WELL_ROWS;
+      for (size_t row = from; row < WELL_ROWS; row++) {
+        for (size_t col = 0; col < widths[i]; col++) {
+          if (rand() % 2) {
+            TetrominoWell_fill(w, row, col);
+          }
+        }
+      }
+
+      _th_assert_features(_th_features(w), TetrominoWell_features(w));
+    }
+
+    TetrominoWell_free(w);
+  }
+}
+
+void test_eval_score_weights_features(void) {
+  EvalWeights const weights = {.holes = -2.0f, .lines = 1.5f};
+  EvalFeatures const f = {.aggregate_height = 10, .holes = 3, .lines = 2};
+  TEST_ASSERT_EQUAL_FLOAT(-3.0f, Eval_score(&weights, &f));
+
+  TetrominoWell_fill(WELL, WELL_ROWS - 1, 0);
+  TetrominoWell_fill(WELL, WELL_ROWS - 3, 0);
+  TEST_ASSERT_EQUAL_FLOAT(-2.0f, TetrominoWell_eval(WELL, &weights));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_eval_empty_well);
+  RUN_TEST(test_eval_hand_built_well);
+  RUN_TEST(test_eval_well_depths_are_cumulative);
+  RUN_TEST(test_eval_matches_per_cell_features);
+  RUN_TEST(test_eval_score_weights_features);
+  return UNITY_END();
+}
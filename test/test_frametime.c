@@ -0,0 +1,87 @@
+#include "cmake_variables.h"
+#include "frametime.c"
+#include "frametime.h"
+#include "unity.h"
+#include <stdlib.h>
+
+static FrameTimes TIMES;
+
+void setUp(void) { memset(&TIMES, 0, sizeof(TIMES)); }
+
+void tearDown(void) {}
+
+static int _th_cmp(void const *a, void const *b) {
+  uint32_t const x = *(uint32_t const *)a, y = *(uint32_t const *)b;
+  return (x > y) - (x < y);
+}
+
+void test_frame_times_sum_phases_per_frame(void) {
+  FrameStats stats = FrameTimes_stats(&TIMES, FRAME_PHASE_SIM);
+  TEST_ASSERT_EQUAL_size_t(0, stats.frames);
+  TEST_ASSERT_EQUAL_UINT(0, stats.min);
+
+  // Input arrives as several events in one frame
+  FrameTimes_add(&TIMES, FRAME_PHASE_INPUT, 100);
+  FrameTimes_add(&TIMES, FRAME_PHASE_INPUT, 50);
+  FrameTimes_add(&TIMES, FRAME_PHASE_SIM, 1000);
+  FrameTimes_commit(&TIMES);
+  FrameTimes_add(&TIMES, FRAME_PHASE_SIM, 3000);
+  FrameTimes_commit(&TIMES);
+
+  stats = FrameTimes_stats(&TIMES, FRAME_PHASE_INPUT);
+  TEST_ASSERT_EQUAL_size_t(2, stats.frames);
+  TEST_ASSERT_EQUAL_UINT(0, stats.min);
+  TEST_ASSERT_EQUAL_UINT(150, stats.max);
+
+  stats = FrameTimes_stats(&TIMES, FRAME_PHASE_SIM);
+  TEST_ASSERT_EQUAL_UINT(1000, stats.min);
+  TEST_ASSERT_EQUAL_UINT(2000, stats.avg);
+  TEST_ASSERT_EQUAL_UINT(3000, stats.p99);
+}
+
+void test_frame_times_p99_matches_sorting(void) {
+  srand(7);
+  uint32_t sorted[FRAME_TIMES_CAP];
+
+  for (size_t round = 0; round < 50; round++) {
+    // Wraps the ring a few times, only the last FRAME_TIMES_CAP frames count
+    size_t const frames = FRAME_TIMES_CAP + (size_t)rand() % (3 * FRAME_TIMES_CAP);
+    for (size_t f = 0; f < frames; f++) {
+      // Few distinct values, lots of duplicates for the selection to get wrong
+      uint32_t const ns = (uint32_t)(rand() % (round % 2 ? 5 : 100000));
+      FrameTimes_add(&TIMES, FRAME_PHASE_RENDER, ns);
+      FrameTimes_commit(&TIMES);
+      if (f + FRAME_TIMES_CAP >= frames) {
+        sorted[f + FRAME_TIMES_CAP - frames] = ns;
+      }
+    }
+    qsort(sorted, FRAME_TIMES_CAP, sizeof(uint32_t), _th_cmp);
+
+    FrameStats const stats = FrameTimes_stats(&TIMES, FRAME_PHASE_RENDER);
+    TEST_ASSERT_EQUAL_size_t(FRAME_TIMES_CAP, stats.frames);
+    TEST_ASSERT_EQUAL_UINT(sorted[0], stats.min);
+    TEST_ASSERT_EQUAL_UINT(sorted[(FRAME_TIMES_CAP * 99 + 99) / 100 - 1], stats.p99);
+    TEST_ASSERT_EQUAL_UINT(sorted[FRAME_TIMES_CAP - 1], stats.max);
+  }
+}
+
+void test_frame_timer_measures_its_phase(void) {
+  FrameTimer const timer = FrameTimer_begin(&TIMES, FRAME_PHASE_PRESENT);
+  struct timespec const nap = {0, 2000000};
+  nanosleep(&nap, NULL);
+  FrameTimer_end(&timer);
+  FrameTimes_commit(&TIMES);
+
+  FrameStats const stats = FrameTimes_stats(&TIMES, FRAME_PHASE_PRESENT);
+  TEST_ASSERT_GREATER_OR_EQUAL(2000000, stats.min);
+  TEST_ASSERT_EQUAL_UINT(0, FrameTimes_stats(&TIMES, FRAME_PHASE_SIM).max);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_frame_times_sum_phases_per_frame);
+  RUN_TEST(test_frame_times_p99_matches_sorting);
+  RUN_TEST(test_frame_timer_measures_its_phase);
+  return UNITY_END();
+}
@@ -0,0 +1,214 @@
+#include "atlas.c"
+#include "atlas.h"
+#include "cmake_variables.h"
+#include "loader.c"
+#include "loader.h"
+#include "pack.c"
+#include "pack.h"
+#include "unity.h"
+#include <stdio.h>
+#include <unistd.h>
+
+static char PACK[] = "/tmp/tetris_test_pack.pak";
+static char BMP24[] = "/tmp/tetris_test_pack_rgb.bmp";
+static char BMP32[] = "/tmp/tetris_test_pack_rgba.bmp";
+static char JSON[] = "/tmp/tetris_test_pack.json";
+
+static void _th_put(uint8_t *const p, uint32_t const v, size_t const bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    p[i] = (uint8_t)(v >> (8 * i));
+  }
+}
+
+static void _th_write(char const *const path, void const *const data, size_t const len) {
+  FILE *f = fopen(path, "wb");
+  fwrite(data, 1, len, f);
+  fclose(f);
+}
+
+// 3x2, 24 bit, bottom up, rows padded from 9 to 12 bytes
+static void _th_bmp24(void) {
+  uint8_t bmp[54 + 24] = {'B', 'M'};
+  _th_put(&bmp[2], sizeof(bmp), 4);
+  _th_put(&bmp[10], 54, 4);
+  _th_put(&bmp[14], 40, 4);
+  _th_put(&bmp[18], 3, 4);
+  _th_put(&bmp[22], 2, 4);
+  _th_put(&bmp[26], 1, 2);
+  _th_put(&bmp[28], 24, 2);
+
+  // Bottom row first: blue pixels, then the top row: red, green, white
+  for (size_t x = 0; x < 3; x++) {
+    bmp[54 + 3 * x] = 0xFF;
+  }
+  uint8_t const top[9] = {0, 0, 0xFF, 0, 0xFF, 0, 0xFF, 0xFF, 0xFF};
+  memcpy(&bmp[54 + 12], top, sizeof(top));
+
+  _th_write(BMP24, bmp, sizeof(bmp));
+}
+
+// 2x1, 32 bit bitfields with alpha, top down
+static void _th_bmp32(void) {
+  uint8_t bmp[14 + 56 + 8] = {'B', 'M'};
+  _th_put(&bmp[2], sizeof(bmp), 4);
+  _th_put(&bmp[10], 14 + 56, 4);
+  _th_put(&bmp[14], 56, 4);
+  _th_put(&bmp[18], 2, 4);
+  _th_put(&bmp[22], (uint32_t)-1, 4);
+  _th_put(&bmp[26], 1, 2);
+  _th_put(&bmp[28], 32, 2);
+  _th_put(&bmp[30], 3, 4);
+  _th_put(&bmp[54], 0xFF0000, 4);
+  _th_put(&bmp[58], 0xFF00, 4);
+  _th_put(&bmp[62], 0xFF, 4);
+  _th_put(&bmp[66], 0xFF000000, 4);
+  _th_put(&bmp[70], 0x80112233, 4);
+  _th_put(&bmp[74], 0x00445566, 4);
+
+  _th_write(BMP32, bmp, sizeof(bmp));
+}
+
+void setUp(void) {
+  _th_bmp24();
+  _th_bmp32();
+  _th_write(JSON, "{\"frames\":{}}", 13);
+}
+
+void tearDown(void) {
+  unlink(PACK);
+  unlink(BMP24);
+  unlink(BMP32);
+  unlink(JSON);
+}
+
+void test_pack_round_trip(void) {
+  char const *const paths[] = {BMP24, JSON, BMP32};
+  TEST_ASSERT_TRUE(AssetPack_bake(PACK, paths, 3));
+
+  AssetPack *pack = AssetPack_open(PACK);
+  TEST_ASSERT_NOT_NULL(pack);
+  TEST_ASSERT_EQUAL_UINT(3, pack->header->cnt);
+  TEST_ASSERT_NULL(AssetPack_find(pack, "tetris_test_pack_rgb.bmp"));
+
+  AssetEntry const *const rgb = AssetPack_find(pack, "tetris_test_pack_rgb");
+  TEST_ASSERT_NOT_NULL(rgb);
+  TEST_ASSERT_EQUAL_UINT(ASSET_KIND_RGBA32, rgb->kind);
+  TEST_ASSERT_EQUAL_UINT(3, rgb->w);
+  TEST_ASSERT_EQUAL_UINT(2, rgb->h);
+  TEST_ASSERT_EQUAL_UINT(12, rgb->pitch);
+  TEST_ASSERT_EQUAL_UINT64(0, rgb->offset % ASSET_PACK_ALIGN);
+
+  static const uint8_t expected_rgb[] = {0xFF, 0, 0, 0xFF, 0, 0xFF, 0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                         0,    0, 0xFF, 0xFF, 0, 0, 0xFF, 0xFF, 0, 0, 0xFF, 0xFF};
+  uint8_t const *const rgb_px = AssetPack_data(pack, rgb);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_rgb, rgb_px, sizeof(expected_rgb));
+
+  AssetEntry const *const rgba = AssetPack_find(pack, "tetris_test_pack_rgba");
+  TEST_ASSERT_NOT_NULL(rgba);
+  static const uint8_t expected_rgba[] = {0x11, 0x22, 0x33, 0x80, 0x44, 0x55, 0x66, 0x00};
+  uint8_t const *const rgba_px = AssetPack_data(pack, rgba);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_rgba, rgba_px, sizeof(expected_rgba));
+
+  AssetEntry const *const json = AssetPack_find(pack, "tetris_test_pack.json");
+  TEST_ASSERT_NOT_NULL(json);
+  TEST_ASSERT_EQUAL_UINT(ASSET_KIND_RAW, json->kind);
+  TEST_ASSERT_EQUAL_UINT64(13, json->size);
+  TEST_ASSERT_EQUAL_MEMORY("{\"frames\":{}}", AssetPack_data(pack, json), 13);
+
+  AssetPack_close(pack);
+}
+
+void test_pack_bake_fails_on_bad_inputs(void) {
+  char const *const missing[] = {BMP24, "/tmp/tetris_test_pack_missing.bmp"};
+  TEST_ASSERT_FALSE(AssetPack_bake(PACK, missing, 2));
+
+  // Anything named .bmp has to decode
+  _th_write(BMP24, "BMnot really", 12);
+  char const *const broken[] = {BMP24};
+  TEST_ASSERT_FALSE(AssetPack_bake(PACK, broken, 1));
+}
+
+void test_pack_open_rejects_corruption(void) {
+  char const *const paths[] = {BMP24, JSON};
+  TEST_ASSERT_TRUE(AssetPack_bake(PACK, paths, 2));
+
+  FILE *f = fopen(PACK, "rb");
+  uint8_t data[512];
+  size_t const len = fread(data, 1, sizeof(data), f);
+  fclose(f);
+
+  TEST_ASSERT_NULL(AssetPack_open("/tmp/tetris_test_pack_missing.pak"));
+
+  // Truncated through the last asset
+  _th_write(PACK, data, len - 1);
+  TEST_ASSERT_NULL(AssetPack_open(PACK));
+
+  data[4] = ASSET_PACK_VERSION + 1;
+  _th_write(PACK, data, len);
+  TEST_ASSERT_NULL(AssetPack_open(PACK));
+
+  data[4] = ASSET_PACK_VERSION;
+  // Entry count larger than the index could hold
+  _th_put(&data[8], 1000, 4);
+  _th_write(PACK, data, len);
+  TEST_ASSERT_NULL(AssetPack_open(PACK));
+
+  _th_put(&data[8], 2, 4);
+  // Rows narrower than the image, with the height raised to keep the same size, would be read past their end
+  AssetEntry e;
+  memcpy(&e, &data[sizeof(AssetPackHeader)], sizeof(e));
+  AssetEntry narrow = e;
+  narrow.pitch /= 2;
+  narrow.h *= 2;
+  memcpy(&data[sizeof(AssetPackHeader)], &narrow, sizeof(narrow));
+  _th_write(PACK, data, len);
+  TEST_ASSERT_NULL(AssetPack_open(PACK));
+
+  memcpy(&data[sizeof(AssetPackHeader)], &e, sizeof(e));
+  _th_write(PACK, data, len);
+  AssetPack *pack = AssetPack_open(PACK);
+  TEST_ASSERT_NOT_NULL(pack);
+  AssetPack_close(pack);
+}
+
+void test_loader_parses_atlas_off_thread(void) {
+  static char const atlas[] = "{\"frames\":[{\"frame\":{\"x\":0,\"y\":0,\"w\":2,\"h\":1}}],"
+                              "\"meta\":{\"image\":\"tetris_test_pack_rgba.png\",\"size\":{\"w\":2,\"h\":1}}}";
+  _th_write(JSON, atlas, sizeof(atlas) - 1);
+  char const *const paths[] = {BMP32, JSON};
+  TEST_ASSERT_TRUE(AssetPack_bake(PACK, paths, 2));
+
+  AssetLoader *loader = AssetLoader_start(PACK, "tetris_test_pack.json");
+  TEST_ASSERT_NOT_NULL(loader);
+  TEST_ASSERT_TRUE(AssetLoader_finish(loader));
+  TEST_ASSERT_TRUE(AssetLoader_done(loader));
+  TEST_ASSERT_EQUAL_size_t(1, loader->atlas.cnt);
+  TEST_ASSERT_EQUAL_STRING("tetris_test_pack_rgba.png", loader->atlas.image);
+
+  AssetPack *pack = AssetLoader_take_pack(loader);
+  TEST_ASSERT_NOT_NULL(pack);
+  TEST_ASSERT_NULL(loader->pack);
+  AssetLoader_free(loader);
+
+  // The pack outlives its loader
+  TEST_ASSERT_NOT_NULL(AssetPack_find(pack, "tetris_test_pack_rgba"));
+  AssetPack_close(pack);
+
+  loader = AssetLoader_start(PACK, "missing.json");
+  TEST_ASSERT_FALSE(AssetLoader_finish(loader));
+  AssetLoader_free(loader);
+
+  loader = AssetLoader_start("/tmp/tetris_test_pack_missing.pak", "tetris_test_pack.json");
+  TEST_ASSERT_FALSE(AssetLoader_finish(loader));
+  AssetLoader_free(loader);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_pack_round_trip);
+  RUN_TEST(test_pack_bake_fails_on_bad_inputs);
+  RUN_TEST(test_pack_open_rejects_corruption);
+  RUN_TEST(test_loader_parses_atlas_off_thread);
+  return UNITY_END();
+}
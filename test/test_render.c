@@ -0,0 +1,101 @@
+#include "cmake_variables.h"
+#include "game.h"
+#include "render.c"
+#include "render.h"
+#include "unity.h"
+#include <stdlib.h>
+
+// Nothing here needs a window or renderer, batches are built and checked on the CPU only
+
+static const uint64_t SEED = 0xC0FFEE;
+static GameState *STATE = NULL;
+static SpriteBatch *BATCH = NULL;
+static WellView VIEW = {0};
+
+void setUp(void) {
+  STATE = GameState_init(SEED);
+  BATCH = SpriteBatch_init(RENDER_STACK_QUADS(WELL_ROWS, WELL_COLS));
+
+  VIEW = (WellView){.x = 10, .y = 20, .mino = RENDER_MINO_PIXELS};
+  for (size_t shape = 0; shape < TETROMINO_SHAPE_CNT; shape++) {
+    VIEW.uv[shape] = (SDL_FRect){0, 0, 1, 1};
+    VIEW.tint[shape] = (SDL_FColor){1.0f, 1.0f, 1.0f, 1.0f};
+  }
+}
+
+void tearDown(void) {
+  SpriteBatch_free(BATCH);
+  GameState_free(STATE);
+}
+
+// Top left corner of a quad, in minos relative to the view
+static void _th_cell(size_t const quad, float *const row, float *const col) {
+  SDL_Vertex const *const v = &BATCH->verts[quad * 4];
+  *row = (v->position.y - VIEW.y) / VIEW.mino;
+  *col = (v->position.x - VIEW.x) / VIEW.mino;
+}
+
+void test_build_pieces_draws_ghost_and_active(void) {
+  WellView_build_pieces(&VIEW, BATCH, STATE, 0);
+  TEST_ASSERT_EQUAL_size_t(0, BATCH->cnt);
+
+  Game_step(STATE, INPUT_NONE);
+  WellView_build_pieces(&VIEW, BATCH, STATE, 0);
+  TEST_ASSERT_EQUAL_size_t(RENDER_PIECE_QUADS, BATCH->cnt);
+
+  // Ghost first at the bottom, faded, then the active piece over it, part of the way into its next row
+  MinoCoords const active = TetrominoWell_coords(STATE->active);
+  float const fall = Game_fall_offset(STATE, 0);
+  TEST_ASSERT_TRUE(fall > 0);
+  for (size_t m = 0; m < MINO_CNT; m++) {
+    float row, col;
+    _th_cell(m, &row, &col);
+    TEST_ASSERT_TRUE(row > (float)active.coords[2 * m]);
+    TEST_ASSERT_TRUE(BATCH->verts[m * 4].color.a < 1.0f);
+
+    _th_cell(MINO_CNT + m, &row, &col);
+    TEST_ASSERT_EQUAL_FLOAT((float)active.coords[2 * m] + fall, row);
+    TEST_ASSERT_EQUAL_FLOAT((float)active.coords[2 * m + 1], col);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, BATCH->verts[(MINO_CNT + m) * 4].color.a);
+  }
+}
+
+void test_build_pieces_skips_hidden_minos(void) {
+  Game_step(STATE, INPUT_NONE);
+  MinoCoords const c = TetrominoWell_coords(STATE->active);
+  Tetromino_hide_mino(STATE->active, (uint8_t)c.coords[0]);
+
+  size_t hidden = 0;
+  for (size_t m = 0; m < MINO_CNT; m++) {
+    hidden += (STATE->active->mino_mask >> m) & 1;
+  }
+  TEST_ASSERT_GREATER_THAN(0, hidden);
+
+  WellView_build_pieces(&VIEW, BATCH, STATE, 0);
+  TEST_ASSERT_EQUAL_size_t(2 * (MINO_CNT - hidden), BATCH->cnt);
+}
+
+void test_build_stack_draws_selected_rows(void) {
+  Game_step(STATE, INPUT_NONE);
+  Game_step(STATE, INPUT_HARD_DROP);
+
+  uint64_t rows[(WELL_ROWS + 63) / 64];
+  memset(rows, 0xFF, sizeof(rows));
+  WellView_build_stack(&VIEW, BATCH, STATE->well, rows);
+  TEST_ASSERT_EQUAL_size_t(MINO_CNT, BATCH->cnt);
+
+  // Only the bottom row
+  memset(rows, 0, sizeof(rows));
+  rows[(WELL_ROWS - 1) / 64] = 1ULL << ((WELL_ROWS - 1) % 64);
+  WellView_build_stack(&VIEW, BATCH, STATE->well, rows);
+  TEST_ASSERT_EQUAL_size_t(STATE->well->fill[WELL_ROWS - 1], BATCH->cnt);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_build_pieces_draws_ghost_and_active);
+  RUN_TEST(test_build_pieces_skips_hidden_minos);
+  RUN_TEST(test_build_stack_draws_selected_rows);
+  return UNITY_END();
+}
@@ -0,0 +1,170 @@
+#include "bag.c"
+#include "bag.h"
+#include "cmake_variables.h"
+#include "game.c"
+#include "game.h"
+#include "replay.c"
+#include "replay.h"
+#include "unity.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+static const uint64_t SEED = 0xC0FFEE;
+static char PATH[] = "/tmp/tetris_test_replay.bin";
+static GameState *STATE = NULL;
+
+void setUp(void) { STATE = GameState_init(SEED); }
+
+void tearDown(void) {
+  GameState_free(STATE);
+  STATE = NULL;
+  unlink(PATH);
+}
+
+// Plays a random game while recording it, idle stretches make the deltas span several varint bytes
+static size_t _th_record(GameState *const state, uint64_t const seed, uint64_t const ticks) {
+  GameState_reset(state, seed);
+  ReplayWriter *writer = ReplayWriter_init(PATH, state, seed);
+  TEST_ASSERT_NOT_NULL(writer);
+
+  srand((unsigned)seed);
+  while (state->tick < ticks) {
+    InputMask const input = rand() % 4 == 0 ? (InputMask)(rand() & 0x3F) : INPUT_NONE;
+    if (Game_step(state, input) == GAME_STATUS_OVER) {
+      break;
+    }
+    ReplayWriter_step(writer, state, input);
+  }
+
+  size_t const events = writer->events;
+  TEST_ASSERT_TRUE(ReplayWriter_close(writer, state));
+  return events;
+}
+
+static void _th_write(uint8_t const *const bytes, size_t const len) {
+  FILE *f = fopen(PATH, "wb");
+  fwrite(bytes, 1, len, f);
+  fclose(f);
+}
+
+void test_replay_round_trip(void) {
+  size_t const events = _th_record(STATE, SEED, 5000);
+  uint64_t const tick = STATE->tick;
+  uint64_t const hash = STATE->well->hash;
+  size_t const lines = STATE->lines;
+
+  Replay *replay = Replay_open(PATH);
+  TEST_ASSERT_NOT_NULL(replay);
+  TEST_ASSERT_EQUAL_UINT64(SEED, replay->seed);
+  TEST_ASSERT_EQUAL_UINT64(events, replay->events);
+  TEST_ASSERT_EQUAL_UINT64(tick, replay->end_tick);
+
+  // Playback into a fresh game, twice, must land on the exact same well
+  GameState *other = GameState_init(1);
+  for (int i = 0; i < 2; i++) {
+    TEST_ASSERT_TRUE(Replay_play(replay, other));
+    TEST_ASSERT_EQUAL_UINT64(tick, other->tick);
+    TEST_ASSERT_EQUAL_UINT64(hash, other->well->hash);
+    TEST_ASSERT_EQUAL_size_t(lines, other->lines);
+  }
+
+  GameState_free(other);
+  Replay_close(replay);
+}
+
+void test_replay_events_decode_in_order(void) {
+  GameState_reset(STATE, SEED);
+  ReplayWriter *writer = ReplayWriter_init(PATH, STATE, SEED);
+
+  // Deltas of 1, 127, 128 and 300000 ticks cover one to three byte varints
+  uint64_t const at[] = {1, 128, 256, 300256};
+  for (size_t i = 0; i < sizeof(at) / sizeof(at[0]); i++) {
+    STATE->tick = at[i];
+    ReplayWriter_step(writer, STATE, INPUT_MOVE_LEFT);
+    ReplayWriter_step(writer, STATE, INPUT_MOVE_RIGHT);
+  }
+  // Idle ticks are not recorded
+  STATE->tick++;
+  ReplayWriter_step(writer, STATE, INPUT_NONE);
+  TEST_ASSERT_TRUE(ReplayWriter_close(writer, STATE));
+
+  Replay *replay = Replay_open(PATH);
+  TEST_ASSERT_NOT_NULL(replay);
+  TEST_ASSERT_EQUAL_size_t(REPLAY_HEADER_SIZE + 1 + 1 + 2 + 3 + 4, replay->size);
+
+  uint64_t tick;
+  InputMask input;
+  for (size_t i = 0; i < sizeof(at) / sizeof(at[0]); i++) {
+    TEST_ASSERT_TRUE(Replay_next(replay, &tick, &input));
+    TEST_ASSERT_EQUAL_UINT64(at[i], tick);
+    TEST_ASSERT_EQUAL_INT(INPUT_MOVE_LEFT, input);
+  }
+  TEST_ASSERT_FALSE(Replay_next(replay, &tick, &input));
+
+  Replay_rewind(replay);
+  TEST_ASSERT_TRUE(Replay_next(replay, &tick, &input));
+  TEST_ASSERT_EQUAL_UINT64(1, tick);
+
+  Replay_close(replay);
+}
+
+void test_replay_rejects_bad_headers(void) {
+  _th_record(STATE, SEED, 100);
+
+  FILE *f = fopen(PATH, "rb");
+  uint8_t bytes[REPLAY_HEADER_SIZE];
+  TEST_ASSERT_EQUAL_size_t(sizeof(bytes), fread(bytes, 1, sizeof(bytes), f));
+  fclose(f);
+
+  TEST_ASSERT_NULL(Replay_open("/tmp/tetris_test_replay_missing.bin"));
+
+  _th_write(bytes, REPLAY_HEADER_SIZE - 1);
+  TEST_ASSERT_NULL(Replay_open(PATH));
+
+  bytes[REPLAY_OFFSET_VERSION] = REPLAY_VERSION + 1;
+  _th_write(bytes, sizeof(bytes));
+  TEST_ASSERT_NULL(Replay_open(PATH));
+
+  bytes[REPLAY_OFFSET_VERSION] = REPLAY_VERSION;
+  bytes[REPLAY_OFFSET_MAGIC] = 'X';
+  _th_write(bytes, sizeof(bytes));
+  TEST_ASSERT_NULL(Replay_open(PATH));
+}
+
+void test_replay_truncated_events_stop_cleanly(void) {
+  uint8_t bytes[REPLAY_HEADER_SIZE + 2] = {0};
+  memcpy(&bytes[REPLAY_OFFSET_MAGIC], REPLAY_MAGIC, 4);
+  bytes[REPLAY_OFFSET_VERSION] = REPLAY_VERSION;
+  // A varint that promises another byte, then the file ends
+  bytes[REPLAY_HEADER_SIZE] = 0x85;
+  bytes[REPLAY_HEADER_SIZE + 1] = 0x80;
+  _th_write(bytes, sizeof(bytes));
+
+  Replay *replay = Replay_open(PATH);
+  TEST_ASSERT_NOT_NULL(replay);
+
+  uint64_t tick;
+  InputMask input;
+  TEST_ASSERT_FALSE(Replay_next(replay, &tick, &input));
+  Replay_close(replay);
+}
+
+void test_replay_detects_divergence(void) {
+  _th_record(STATE, SEED, 2000);
+
+  Replay *replay = Replay_open(PATH);
+  replay->hash ^= 1;
+  TEST_ASSERT_FALSE(Replay_play(replay, STATE));
+  Replay_close(replay);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_replay_round_trip);
+  RUN_TEST(test_replay_events_decode_in_order);
+  RUN_TEST(test_replay_rejects_bad_headers);
+  RUN_TEST(test_replay_truncated_events_stop_cleanly);
+  RUN_TEST(test_replay_detects_divergence);
+  return UNITY_END();
+}
@@ -0,0 +1,163 @@
+#include "bag.c"
+#include "bag.h"
+#include "cmake_variables.h"
+#include "collide.c"
+#include "collide.h"
+#include "game.c"
+#include "game.h"
+#include "movegen.c"
+#include "movegen.h"
+#include "unity.h"
+#include <stdlib.h>
+
+static TetrominoWell *WELL = NULL;
+static MoveGen *GEN = NULL;
+
+void setUp(void) {
+  WELL = TetrominoWell_init(WELL_ROWS, WELL_COLS);
+  GEN = calloc(1, sizeof(MoveGen));
+}
+
+void tearDown(void) {
+  TetrominoWell_free(WELL);
+  free(GEN);
+  WELL = NULL;
+  GEN = NULL;
+}
+
+void _th_TetrominoWell_fill_row(TetrominoWell *const w, size_t const row, size_t const from, size_t const to) {
+  for (size_t col = from; col < to; col++) {
+    TetrominoWell_fill(w, row, col);
+  }
+}
+
+bool _th_has_placement(MoveGen const *const gen, ETetrominoShape const shape, size_t const row, size_t const col) {
+  for (size_t i = 0; i < gen->cnt; i++) {
+    Tetromino const t = Placement_tetromino(gen->placements[i], shape);
+    MinoCoords const c = TetrominoWell_coords(&t);
+    for (size_t m = 0; m < MINO_COORDS_SIZE; m += 2) {
+      if (c.coords[m] == row && c.coords[m + 1] == col) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void test_movegen_empty_well_counts(void) {
+  // Distinct footprints resting on the floor of an empty 10 wide well
+  static const size_t expected[TETROMINO_SHAPE_CNT] = {
+      [TETROMINO_SHAPE_I] = 17, [TETROMINO_SHAPE_J] = 34, [TETROMINO_SHAPE_L] = 34, [TETROMINO_SHAPE_O] = 9,
+      [TETROMINO_SHAPE_S] = 17, [TETROMINO_SHAPE_T] = 34, [TETROMINO_SHAPE_Z] = 17,
+  };
+
+  for (ETetrominoShape shape = 0; shape < TETROMINO_SHAPE_CNT; shape++) {
+    Tetromino *t = Tetromino_init(WELL->pool, shape, 0, 4);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(expected[shape], MoveGen_placements(GEN, WELL, t), "placement count");
+
+    for (size_t i = 0; i < GEN->cnt; i++) {
+      Tetromino const p = Placement_tetromino(GEN->placements[i], shape);
+      TEST_ASSERT_FALSE(TetrominoWell_collision(WELL, &p, 0, 0));
+      TEST_ASSERT_TRUE(TetrominoWell_collision(WELL, &p, 1, 0));
+    }
+
+    Tetromino_free(WELL->pool, t);
+  }
+}
+
+void test_movegen_finds_tuck_under_overhang(void) {
+  // A roof over columns 0-5 leaves a one row gap above the floor that can only be reached by sliding in from the right
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 3, 0, 6);
+
+  Tetromino *I = Tetromino_init(WELL->pool, TETROMINO_SHAPE_I, 0, 3);
+  MoveGen_placements(GEN, WELL, I);
+
+  TEST_ASSERT_TRUE(_th_has_placement(GEN, TETROMINO_SHAPE_I, WELL_ROWS - 1, 0));
+  TEST_ASSERT_TRUE(_th_has_placement(GEN, TETROMINO_SHAPE_I, WELL_ROWS - 4, 0));
+
+  Tetromino_free(WELL->pool, I);
+}
+
+void test_movegen_flags_spins(void) {
+  // T-slot: the T can only enter the bottom notch pointing down by rotating in place
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 1, 0, 4);
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 1, 5, WELL_COLS);
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 2, 0, 3);
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 2, 6, WELL_COLS);
+  TetrominoWell_fill(WELL, WELL_ROWS - 3, 3);
+
+  Tetromino *T = Tetromino_init(WELL->pool, TETROMINO_SHAPE_T, 0, 4);
+  MoveGen_placements(GEN, WELL, T);
+
+  bool found = false;
+  for (size_t i = 0; i < GEN->cnt; i++) {
+    Placement const p = GEN->placements[i];
+    Tetromino const t = Placement_tetromino(p, TETROMINO_SHAPE_T);
+    MinoCoords const c = TetrominoWell_coords(&t);
+    if (p.rotation == 2 && c.coords[0] == WELL_ROWS - 1 && c.coords[1] == 4) {
+      found = true;
+      TEST_ASSERT_TRUE(p.spin);
+    }
+  }
+  TEST_ASSERT_TRUE(found);
+
+  Tetromino_free(WELL->pool, T);
+}
+
+void test_movegen_path_reaches_every_placement(void) {
+  // Same T-slot and roof as above, so paths need tucks and spins
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 1, 0, 4);
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 1, 5, WELL_COLS);
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 2, 0, 3);
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 2, 6, WELL_COLS);
+  TetrominoWell_fill(WELL, WELL_ROWS - 3, 3);
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 6, 0, 3);
+
+  static InputMask moves[MOVEGEN_MAX_STATES];
+  static MoveGen path_gen;
+
+  for (ETetrominoShape shape = 0; shape < TETROMINO_SHAPE_CNT; shape++) {
+    Tetromino *spawn = Tetromino_init(WELL->pool, shape, 0, 4);
+    MoveGen_placements(GEN, WELL, spawn);
+
+    for (size_t i = 0; i < GEN->cnt; i++) {
+      size_t const len = MoveGen_path(&path_gen, WELL, spawn, GEN->placements[i], moves, MOVEGEN_MAX_STATES);
+      TEST_ASSERT_NOT_EQUAL(MOVEGEN_NO_PATH, len);
+
+      // Every input must succeed when replayed, and end on the placement's cells
+      Tetromino t = *spawn;
+      for (size_t m = 0; m < len; m++) {
+        uint32_t const deg = moves[m] == INPUT_ROTATE_RIGHT ? 90 : moves[m] == INPUT_ROTATE_LEFT ? 270 : 0;
+        size_t const row = moves[m] == INPUT_SOFT_DROP;
+        size_t const col = moves[m] == INPUT_MOVE_LEFT ? (size_t)-1 : moves[m] == INPUT_MOVE_RIGHT;
+        Tetromino_rotate(&t, deg);
+        TEST_ASSERT_FALSE(TetrominoWell_collision(WELL, &t, row, col));
+        Tetromino_translate(&t, row, col);
+      }
+
+      Tetromino const target = Placement_tetromino(GEN->placements[i], shape);
+      MinoCoords const got = TetrominoWell_coords(&t);
+      MinoCoords const want = TetrominoWell_coords(&target);
+      for (size_t m = 0; m < MINO_COORDS_SIZE; m += 2) {
+        bool covered = false;
+        for (size_t n = 0; n < MINO_COORDS_SIZE; n += 2) {
+          covered |= got.coords[n] == want.coords[m] && got.coords[n + 1] == want.coords[m + 1];
+        }
+        TEST_ASSERT_TRUE(covered);
+      }
+    }
+
+    Tetromino_free(WELL->pool, spawn);
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_movegen_empty_well_counts);
+  RUN_TEST(test_movegen_finds_tuck_under_overhang);
+  RUN_TEST(test_movegen_flags_spins);
+  RUN_TEST(test_movegen_path_reaches_every_placement);
+  return UNITY_END();
+}
@@ -0,0 +1,281 @@
+#include "bag.c"
+#include "bag.h"
+#include "batch.c"
+#include "batch.h"
+#include "cmake_variables.h"
+#include "game.c"
+#include "game.h"
+#include "unity.h"
+#include <stdlib.h>
+
+static const uint64_t SEED = 0xC0FFEE;
+static GameState *STATE = NULL;
+
+void setUp(void) { STATE = GameState_init(SEED); }
+
+void tearDown(void) {
+  GameState_free(STATE);
+  STATE = NULL;
+}
+
+void test_step_spawns_and_falls_with_gravity(void) {
+  Game_step(STATE, INPUT_NONE);
+  TEST_ASSERT_NOT_NULL(STATE->active);
+  size_t const row0 = STATE->active->row0;
+
+  for (size_t i = 1; i < GAME_GRAVITY_TICKS; i++) {
+    Game_step(STATE, INPUT_NONE);
+  }
+  TEST_ASSERT_EQUAL_UINT(row0 + 1, STATE->active->row0);
+  TEST_ASSERT_EQUAL_UINT64(GAME_GRAVITY_TICKS, STATE->tick);
+}
+
+void test_step_moves_and_rotates(void) {
+  Game_step(STATE, INPUT_NONE);
+  size_t const col0 = STATE->active->col0;
+
+  Game_step(STATE, INPUT_MOVE_LEFT);
+  TEST_ASSERT_EQUAL_UINT(col0 - 1, STATE->active->col0);
+
+  Game_step(STATE, INPUT_SOFT_DROP | INPUT_ROTATE_RIGHT);
+  Game_step(STATE, INPUT_SOFT_DROP | INPUT_ROTATE_RIGHT);
+  TEST_ASSERT_EQUAL_UINT(180, STATE->active->deg);
+
+  for (size_t i = 0; i < WELL_COLS; i++) {
+    Game_step(STATE, INPUT_MOVE_RIGHT);
+  }
+  TEST_ASSERT_FALSE(TetrominoWell_collision(STATE->well, STATE->active, 0, 0));
+  TEST_ASSERT_TRUE(TetrominoWell_collision(STATE->well, STATE->active, 0, 1));
+}
+
+void test_step_hard_drop_locks(void) {
+  Game_step(STATE, INPUT_NONE);
+  Game_step(STATE, INPUT_HARD_DROP);
+
+  TEST_ASSERT_NULL(STATE->active);
+  TEST_ASSERT_EQUAL_UINT(1, STATE->well->coll->cnt);
+  TEST_ASSERT_GREATER_THAN(0, STATE->well->fill[WELL_ROWS - 1]);
+}
+
+void test_step_lock_delay(void) {
+  Game_step(STATE, INPUT_NONE);
+  while (!TetrominoWell_collision(STATE->well, STATE->active, 1, 0)) {
+    Game_step(STATE, INPUT_SOFT_DROP);
+  }
+
+  // The tick the piece lands on already counts towards the delay
+  TEST_ASSERT_EQUAL_UINT(1, STATE->lock_cnt);
+  for (size_t i = 2; i < GAME_LOCK_DELAY_TICKS; i++) {
+    Game_step(STATE, INPUT_NONE);
+  }
+  TEST_ASSERT_NOT_NULL(STATE->active);
+
+  Game_step(STATE, INPUT_NONE);
+  TEST_ASSERT_NULL(STATE->active);
+}
+
+void test_step_is_deterministic(void) {
+  GameState *other = GameState_init(SEED);
+  static const InputMask inputs[] = {INPUT_NONE, INPUT_MOVE_LEFT, INPUT_ROTATE_RIGHT, INPUT_HARD_DROP,
+                                     INPUT_MOVE_RIGHT, INPUT_SOFT_DROP, INPUT_HARD_DROP};
+
+  for (size_t i = 0; i < 5000; i++) {
+    InputMask const in = inputs[(i * 7919) % (sizeof(inputs) / sizeof(inputs[0]))];
+    TEST_ASSERT_EQUAL_INT(Game_step(STATE, in), Game_step(other, in));
+  }
+
+  TEST_ASSERT_EQUAL_INT(GAME_STATUS_OVER, STATE->status);
+  TEST_ASSERT_EQUAL_UINT64(STATE->tick, other->tick);
+  TEST_ASSERT_EQUAL_UINT(STATE->well->coll->cnt, other->well->coll->cnt);
+  TEST_ASSERT_EQUAL_MEMORY(STATE->well->bits, other->well->bits, sizeof(WellWord) * WELL_ROWS);
+
+  GameState_free(other);
+}
+
+void test_frame_clock_is_exact_at_any_refresh_rate(void) {
+  // 144 Hz frames do not divide a 60 Hz tick, yet one second still yields exactly GAME_TICK_RATE ticks
+  static const uint64_t rates[] = {30, 60, 75, 144, 165, 240};
+
+  for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+    FrameClock clock;
+    FrameClock_init(&clock, 1000);
+
+    uint64_t ticks = 0;
+    for (uint64_t frame = 1; frame <= rates[r] * 10; frame++) {
+      ticks += FrameClock_advance(&clock, 1000 + frame * 1000000000ULL / rates[r]);
+      TEST_ASSERT_TRUE(FrameClock_alpha(&clock) >= 0 && FrameClock_alpha(&clock) < 1);
+    }
+    TEST_ASSERT_EQUAL_UINT64(GAME_TICK_RATE * 10, ticks);
+  }
+}
+
+void test_frame_clock_drops_long_stalls(void) {
+  FrameClock clock;
+  FrameClock_init(&clock, 0);
+
+  TEST_ASSERT_EQUAL_UINT(GAME_MAX_CATCHUP_TICKS, FrameClock_advance(&clock, 5000000000ULL));
+  TEST_ASSERT_EQUAL_UINT(0, FrameClock_advance(&clock, 5000000000ULL));
+  // Time going backwards counts as no time
+  TEST_ASSERT_EQUAL_UINT(0, FrameClock_advance(&clock, 1));
+}
+
+void test_fall_offset_follows_gravity(void) {
+  Game_step(STATE, INPUT_NONE);
+  TEST_ASSERT_EQUAL_FLOAT(1.0f / GAME_GRAVITY_TICKS, Game_fall_offset(STATE, 0));
+  TEST_ASSERT_EQUAL_FLOAT(1.5f / GAME_GRAVITY_TICKS, Game_fall_offset(STATE, 0.5f));
+
+  // Resting on the floor it stays put
+  while (!TetrominoWell_collision(STATE->well, STATE->active, 1, 0)) {
+    Game_step(STATE, INPUT_SOFT_DROP);
+  }
+  TEST_ASSERT_EQUAL_FLOAT(0, Game_fall_offset(STATE, 0.5f));
+}
+
+void test_bag_deals_every_shape_once_per_bag(void) {
+  PieceBag bag;
+  PieceBag_init(&bag, SEED);
+
+  for (size_t b = 0; b < 1000; b++) {
+    uint32_t seen = 0;
+    for (size_t i = 0; i < BAG_SIZE; i++) {
+      uint8_t const shape = PieceBag_next(&bag);
+      TEST_ASSERT_LESS_THAN_UINT(TETROMINO_SHAPE_CNT, shape);
+      seen |= 1u << shape;
+    }
+    TEST_ASSERT_EQUAL_HEX32((1u << TETROMINO_SHAPE_CNT) - 1, seen);
+  }
+}
+
+void test_bag_skip_matches_dealing(void) {
+  static const uint64_t skips[] = {0, 1, 5, 6, 7, 8, 13, 14, 100, 701};
+
+  for (size_t start = 0; start < BAG_SIZE; start++) {
+    for (size_t s = 0; s < sizeof(skips) / sizeof(skips[0]); s++) {
+      PieceBag dealt, skipped;
+      PieceBag_init(&dealt, SEED + start);
+      for (size_t i = 0; i < start; i++) {
+        PieceBag_next(&dealt);
+      }
+      skipped = dealt;
+
+      for (uint64_t i = 0; i < skips[s]; i++) {
+        PieceBag_next(&dealt);
+      }
+      PieceBag_skip(&skipped, skips[s]);
+
+      uint8_t expected[2 * BAG_SIZE], actual[2 * BAG_SIZE];
+      PieceBag_peek(&dealt, expected, 2 * BAG_SIZE);
+      PieceBag_peek(&skipped, actual, 2 * BAG_SIZE);
+      TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, 2 * BAG_SIZE);
+    }
+  }
+}
+
+void test_preview_matches_spawns(void) {
+  TEST_ASSERT_EQUAL_size_t(GAME_PREVIEW_CNT, STATE->preview);
+
+  ETetrominoShape preview[GAME_HASH_MAX_PREVIEW];
+  Game_preview(STATE, preview, GAME_HASH_MAX_PREVIEW);
+
+  for (size_t i = 0; i < GAME_HASH_MAX_PREVIEW; i++) {
+    Game_step(STATE, INPUT_NONE);
+    TEST_ASSERT_EQUAL_INT(preview[i], STATE->active->shape);
+    Game_step(STATE, INPUT_HARD_DROP);
+    GameState_reset(STATE, SEED);
+    PieceBag_skip(&STATE->bag, i + 1);
+  }
+
+  // Each game owns its generator, other seeds give other sequences
+  GameState *other = GameState_init(SEED + 1);
+  ETetrominoShape other_preview[GAME_HASH_MAX_PREVIEW];
+  Game_preview(other, other_preview, GAME_HASH_MAX_PREVIEW);
+  TEST_ASSERT_TRUE(memcmp(preview, other_preview, sizeof(preview)) != 0);
+  GameState_free(other);
+}
+
+void test_hash_covers_the_preview(void) {
+  Game_step(STATE, INPUT_NONE);
+  uint64_t const full = Game_hash(STATE);
+
+  ETetrominoShape shapes[GAME_PREVIEW_CNT];
+  Game_preview(STATE, shapes, GAME_PREVIEW_CNT);
+  STATE->preview = 0;
+  TEST_ASSERT_EQUAL_UINT64(STATE->well->hash ^ Tetromino_hash(STATE->active), Game_hash(STATE));
+  TEST_ASSERT_EQUAL_UINT64(full, Game_hash(STATE) ^ Game_queue_hash(shapes, GAME_PREVIEW_CNT));
+}
+
+InputMask _th_scripted_input(GameState const *const state, size_t const game_idx, void *const UNUSED(ctx)) {
+  static const InputMask script[] = {INPUT_MOVE_LEFT, INPUT_NONE, INPUT_ROTATE_RIGHT, INPUT_MOVE_RIGHT,
+                                     INPUT_SOFT_DROP, INPUT_NONE, INPUT_HARD_DROP};
+
+  return script[(state->tick + game_idx) % (sizeof(script) / sizeof(script[0]))];
+}
+
+void test_batch_matches_sequential_games(void) {
+  size_t const games = 37;
+  uint64_t const ticks = 400;
+  BatchSim *sim = BatchSim_init(games, 4, SEED, _th_scripted_input, NULL);
+
+  BatchSim_run(sim, ticks / 2);
+  BatchSim_run(sim, ticks / 2);
+  TEST_ASSERT_EQUAL_UINT64(games * ticks, BatchSim_ticks(sim));
+  TEST_ASSERT_GREATER_THAN(0.0, BatchSim_ticks_per_sec(sim));
+
+  for (size_t i = 0; i < games; i++) {
+    GameState *expected = GameState_init(BatchSim_seed(SEED, i));
+    for (uint64_t t = 0; t < ticks; t++) {
+      if (Game_step(expected, _th_scripted_input(expected, i, NULL)) == GAME_STATUS_OVER) {
+        GameState_reset(expected, BatchSim_seed(expected->bag.rng.state, i));
+      }
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(expected->tick, sim->games[i]->tick);
+    TEST_ASSERT_EQUAL_UINT(expected->well->coll->cnt, sim->games[i]->well->coll->cnt);
+    TEST_ASSERT_EQUAL_MEMORY(expected->well->bits, sim->games[i]->well->bits, sizeof(WellWord) * WELL_ROWS);
+
+    // Games on neighbouring workers must not share a cache line
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)sim->games[i] % CACHE_LINE_SIZE);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)sim->games[i]->well % CACHE_LINE_SIZE);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)sim->games[i]->well->bits % CACHE_LINE_SIZE);
+    GameState_free(expected);
+  }
+
+  BatchSim_free(sim);
+}
+
+void test_batch_restarts_finished_games(void) {
+  BatchSim *sim = BatchSim_init(8, 3, SEED, _th_scripted_input, NULL);
+
+  BatchSim_run(sim, 20000);
+
+  uint64_t games_over = 0;
+  for (size_t w = 0; w < sim->workers_cnt; w++) {
+    games_over += sim->workers[w].games_over;
+  }
+  TEST_ASSERT_GREATER_THAN(0, games_over);
+  for (size_t i = 0; i < sim->games_cnt; i++) {
+    TEST_ASSERT_EQUAL_INT(GAME_STATUS_PLAYING, sim->games[i]->status);
+  }
+
+  BatchSim_free(sim);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_step_spawns_and_falls_with_gravity);
+  RUN_TEST(test_step_moves_and_rotates);
+  RUN_TEST(test_step_hard_drop_locks);
+  RUN_TEST(test_step_lock_delay);
+  RUN_TEST(test_step_is_deterministic);
+  RUN_TEST(test_frame_clock_is_exact_at_any_refresh_rate);
+  RUN_TEST(test_frame_clock_drops_long_stalls);
+  RUN_TEST(test_fall_offset_follows_gravity);
+  RUN_TEST(test_bag_deals_every_shape_once_per_bag);
+  RUN_TEST(test_bag_skip_matches_dealing);
+  RUN_TEST(test_preview_matches_spawns);
+  RUN_TEST(test_hash_covers_the_preview);
+  RUN_TEST(test_batch_matches_sequential_games);
+  RUN_TEST(test_batch_restarts_finished_games);
+  return UNITY_END();
+}
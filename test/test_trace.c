@@ -0,0 +1,113 @@
+// The trace points are tested as a TETRIS_TRACE build records them, whether or not this build is one
+#ifndef TETRIS_TRACE
+#define TETRIS_TRACE
+#endif
+
+#include "cmake_variables.h"
+#include "trace.c"
+#include "trace.h"
+#include "unity.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TH_THREADS 4
+// Three events each, all of them fit in the buffer at once
+#define TH_EVENTS 4000
+
+static char TRACE[] = "/tmp/tetris_test_trace.json";
+
+void setUp(void) {}
+
+void tearDown(void) { remove(TRACE); }
+
+static char *_th_read(char const *const path) {
+  FILE *f = fopen(path, "rb");
+  TEST_ASSERT_NOT_NULL(f);
+  fseek(f, 0, SEEK_END);
+  long const len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  char *text = calloc((size_t)len + 1, 1);
+  TEST_ASSERT_EQUAL_size_t((size_t)len, fread(text, 1, (size_t)len, f));
+  fclose(f);
+  return text;
+}
+
+// A plain scan, strstr from each match is quadratic under the sanitizers that measure the whole text every call
+static size_t _th_count(char const *const text, char const *const needle) {
+  size_t const len = strlen(needle);
+  size_t cnt = 0;
+  for (char const *p = text; *p != '\0'; p++) {
+    cnt += strncmp(p, needle, len) == 0;
+  }
+  return cnt;
+}
+
+static void *_th_record(void *const arg) {
+  (void)arg;
+  TRACE_THREAD_NAME("worker");
+  for (int64_t i = 0; i < TH_EVENTS; i++) {
+    TRACE_BEGIN("work");
+    TRACE_INSTANT("step", i);
+    TRACE_END("work");
+  }
+  return NULL;
+}
+
+void test_trace_records_nothing_unless_started(void) {
+  TRACE_BEGIN("ignored");
+  TRACE_END("ignored");
+  Trace_stop();
+  TEST_ASSERT_EQUAL_UINT64(0, Trace_dropped());
+
+  TEST_ASSERT_FALSE(Trace_start("/nonexistent/trace.json"));
+  TEST_ASSERT_TRUE(Trace_start(TRACE));
+  TEST_ASSERT_FALSE(Trace_start(TRACE));
+  Trace_stop();
+
+  char *text = _th_read(TRACE);
+  TEST_ASSERT_EQUAL_STRING("{\"traceEvents\":[\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":\"0\"}}\n",
+                           text);
+  free(text);
+}
+
+void test_trace_writes_every_event_from_every_thread(void) {
+  TEST_ASSERT_TRUE(Trace_start(TRACE));
+  TRACE_ASYNC_BEGIN("piece", 1);
+
+  pthread_t threads[TH_THREADS];
+  for (size_t t = 0; t < TH_THREADS; t++) {
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[t], NULL, _th_record, NULL));
+  }
+  for (size_t t = 0; t < TH_THREADS; t++) {
+    pthread_join(threads[t], NULL);
+  }
+
+  TRACE_ASYNC_END("piece", 1);
+  Trace_stop();
+
+  // The buffer holds more than was recorded, so nothing may be dropped however slow the flusher is
+  TEST_ASSERT_EQUAL_UINT64(0, Trace_dropped());
+
+  char *text = _th_read(TRACE);
+  TEST_ASSERT_EQUAL_STRING_LEN("{\"traceEvents\":[\n{", text, 18);
+  TEST_ASSERT_EQUAL_size_t(TH_THREADS, _th_count(text, "\"ph\":\"M\""));
+  TEST_ASSERT_EQUAL_size_t(TH_THREADS * TH_EVENTS, _th_count(text, "\"name\":\"work\",\"cat\":\"tetris\",\"ph\":\"B\""));
+  TEST_ASSERT_EQUAL_size_t(TH_THREADS * TH_EVENTS, _th_count(text, "\"name\":\"work\",\"cat\":\"tetris\",\"ph\":\"E\""));
+  TEST_ASSERT_EQUAL_size_t(TH_THREADS, _th_count(text, "\"args\":{\"value\":3999}"));
+  TEST_ASSERT_EQUAL_size_t(1, _th_count(text, "\"ph\":\"b\""));
+  TEST_ASSERT_EQUAL_size_t(1, _th_count(text, "\"ph\":\"e\",\"ts\""));
+  TEST_ASSERT_EQUAL_size_t(1, _th_count(text, "\"dropped_events\":\"0\"}}\n"));
+
+  // Every event but the first is separated by a comma, so the JSON array is well formed
+  TEST_ASSERT_EQUAL_size_t(TH_THREADS * (3 * TH_EVENTS + 1) + 2 - 1, _th_count(text, "},\n{"));
+  free(text);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_trace_records_nothing_unless_started);
+  RUN_TEST(test_trace_writes_every_event_from_every_thread);
+  return UNITY_END();
+}
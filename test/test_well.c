@@ -0,0 +1,487 @@
+#include "bag.c"
+#include "bag.h"
+#include "cmake_variables.h"
+#include "collide.c"
+#include "collide.h"
+#include "game.c"
+#include "game.h"
+#include "unity.h"
+#include <stdlib.h>
+
+static TetrominoWell *WELL = NULL;
+
+void setUp(void) { WELL = TetrominoWell_init(WELL_ROWS, WELL_COLS); }
+
+void tearDown(void) {
+  TetrominoWell_free(WELL);
+  WELL = NULL;
+}
+
+void _th_TetrominoWell_fill_row(TetrominoWell *const w, size_t const row, size_t const hole) {
+  for (size_t col = 0; col < w->cols; col++) {
+    if (col != hole) {
+      TetrominoWell_fill(w, row, col);
+    }
+  }
+}
+
+// Reference rotation of a spawn orientation, a[i,j] -> a[j][n-i-1] per quarter turn
+void _th_rotate(size_t const n, size_t const quarter, size_t const row, size_t const col, size_t *out_row,
+                size_t *out_col) {
+  size_t r = row, c = col;
+  for (size_t q = 0; q < quarter; q++) {
+    size_t const tmp = r;
+    r = c;
+    c = n - tmp - 1;
+  }
+  *out_row = r;
+  *out_col = c;
+}
+
+void test_rotation_table(void) {
+  static const size_t bound_size[TETROMINO_SHAPE_CNT] = {4, 3, 3, 2, 3, 3, 3};
+
+  for (ETetrominoShape shape = 0; shape < TETROMINO_SHAPE_CNT; shape++) {
+    TetrominoRotation const *const spawn = &TETROMINO_ROTATIONS[shape][0];
+
+    for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+      TetrominoRotation const *const rot = &TETROMINO_ROTATIONS[shape][q];
+      uint8_t rows[MINO_CNT] = {0};
+      size_t left = SIZE_MAX, right = 0;
+
+      for (size_t m = 0; m < MINO_CNT; m++) {
+        size_t row, col;
+        _th_rotate(bound_size[shape], q, MINO_ROW(spawn->minos[m]), MINO_COL(spawn->minos[m]), &row, &col);
+        TEST_ASSERT_EQUAL_UINT8(MINO_PACK(row, col), rot->minos[m]);
+
+        rows[row] |= 1 << col;
+        left = col < left ? col : left;
+        right = col > right ? col : right;
+      }
+
+      TEST_ASSERT_EQUAL_UINT8_ARRAY(rows, rot->rows, MINO_CNT);
+      TEST_ASSERT_EQUAL_UINT(left, rot->left);
+      TEST_ASSERT_EQUAL_UINT(right, rot->right);
+    }
+  }
+}
+
+void test_well_coords_rotated(void) {
+  Tetromino *J = Tetromino_init(WELL->pool, TETROMINO_SHAPE_J, 5, 3);
+  J->deg = 90;
+
+  size_t expected[MINO_COORDS_SIZE] = {5, 5, 5, 4, 6, 4, 7, 4};
+  MinoCoords actual = TetrominoWell_coords(J);
+  TEST_ASSERT_EQUAL_size_t_ARRAY(expected, actual.coords, MINO_COORDS_SIZE);
+
+  Tetromino_free(WELL->pool, J);
+}
+
+void test_tetromino_hide_mino(void) {
+  Tetromino *T = Tetromino_init(WELL->pool, TETROMINO_SHAPE_T, 4, 5);
+
+  Tetromino_hide_mino(T, 5);
+  TEST_ASSERT_EQUAL_UINT8(0xE, T->mino_mask);
+
+  Tetromino_hide_mino(T, 4);
+  TEST_ASSERT_EQUAL_UINT8(0xF, T->mino_mask);
+
+  Tetromino_free(WELL->pool, T);
+}
+
+void test_well_words_per_row(void) {
+  TEST_ASSERT_EQUAL_UINT(1, WELL->words);
+  TEST_ASSERT_EQUAL_UINT32(0x3FF, WELL->full[0]);
+
+  TetrominoWell *wide = TetrominoWell_init(4, 40);
+  TEST_ASSERT_EQUAL_UINT(2, wide->words);
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, wide->full[0]);
+  TEST_ASSERT_EQUAL_UINT32(0xFF, wide->full[1]);
+  TetrominoWell_free(wide);
+}
+
+void test_well_collision_walls(void) {
+  Tetromino *I = Tetromino_init(WELL->pool, TETROMINO_SHAPE_I, 0, 0);
+
+  TEST_ASSERT_FALSE(TetrominoWell_collision(WELL, I, 0, 0));
+  TEST_ASSERT_TRUE(TetrominoWell_collision(WELL, I, 0, -1));
+  TEST_ASSERT_FALSE(TetrominoWell_collision(WELL, I, 0, WELL_COLS - 4));
+  TEST_ASSERT_TRUE(TetrominoWell_collision(WELL, I, 0, WELL_COLS - 3));
+  TEST_ASSERT_FALSE(TetrominoWell_collision(WELL, I, WELL_ROWS - 1, 0));
+  TEST_ASSERT_TRUE(TetrominoWell_collision(WELL, I, WELL_ROWS, 0));
+
+  // Vertical I sits in column 2 of its bounding box, so the box may hang over the left wall
+  I->deg = 90;
+  TEST_ASSERT_FALSE(TetrominoWell_collision(WELL, I, 1, -2));
+  TEST_ASSERT_TRUE(TetrominoWell_collision(WELL, I, 1, -3));
+  TEST_ASSERT_FALSE(TetrominoWell_collision(WELL, I, 1, WELL_COLS - 3));
+  TEST_ASSERT_TRUE(TetrominoWell_collision(WELL, I, 1, WELL_COLS - 2));
+
+  Tetromino_free(WELL->pool, I);
+}
+
+void test_well_collision_locked(void) {
+  Tetromino *O = Tetromino_init(WELL->pool, TETROMINO_SHAPE_O, WELL_ROWS - 2, 4);
+  Tetromino *T = Tetromino_init(WELL->pool, TETROMINO_SHAPE_T, 0, 5);
+
+  TetrominoWell_lock(WELL, O);
+  TEST_ASSERT_TRUE(TetrominoWell_occupied(WELL, WELL_ROWS - 1, 5));
+  TEST_ASSERT_FALSE(TetrominoWell_occupied(WELL, WELL_ROWS - 1, 6));
+
+  // T occupies rows 0-1, cols 4-6: it lands on top of O at row offset 16
+  TEST_ASSERT_FALSE(TetrominoWell_collision(WELL, T, WELL_ROWS - 4, 0));
+  TEST_ASSERT_TRUE(TetrominoWell_collision(WELL, T, WELL_ROWS - 3, 0));
+  TEST_ASSERT_FALSE(TetrominoWell_collision(WELL, T, WELL_ROWS - 2, 2));
+
+  Tetromino_free(WELL->pool, O);
+  Tetromino_free(WELL->pool, T);
+}
+
+void test_well_clear_full_rows(void) {
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 1, WELL_COLS);
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 2, 3);
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 3, WELL_COLS);
+
+  TEST_ASSERT_EQUAL_UINT64((1ULL << (WELL_ROWS - 1)) | (1ULL << (WELL_ROWS - 3)), TetrominoWell_full_row_mask(WELL));
+  TEST_ASSERT_EQUAL_UINT(2, TetrominoWell_clear_full_rows(WELL));
+  TEST_ASSERT_EQUAL_UINT64(0, TetrominoWell_full_row_mask(WELL));
+
+  TEST_ASSERT_EQUAL_UINT32(0x3FF & ~(1u << 3), WELL->bits[WELL_ROWS - 1]);
+  for (size_t row = 0; row < WELL_ROWS - 1; row++) {
+    TEST_ASSERT_EQUAL_UINT32(0, WELL->bits[row]);
+  }
+}
+
+void test_well_clear_full_rows_wide(void) {
+  TetrominoWell *wide = TetrominoWell_init(3, 40);
+
+  _th_TetrominoWell_fill_row(wide, 2, wide->cols);
+  _th_TetrominoWell_fill_row(wide, 1, 35);
+
+  TEST_ASSERT_TRUE(TetrominoWell_row_full(wide, 2));
+  TEST_ASSERT_FALSE(TetrominoWell_row_full(wide, 1));
+  TEST_ASSERT_EQUAL_UINT(1, TetrominoWell_clear_full_rows(wide));
+  TEST_ASSERT_FALSE(TetrominoWell_occupied(wide, 2, 35));
+  TEST_ASSERT_TRUE(TetrominoWell_occupied(wide, 2, 39));
+  TEST_ASSERT_FALSE(TetrominoWell_occupied(wide, 1, 0));
+
+  TetrominoWell_free(wide);
+}
+
+void test_well_collision_wide_word_boundary(void) {
+  TetrominoWell *wide = TetrominoWell_init(4, 40);
+  Tetromino *I = Tetromino_init(wide->pool, TETROMINO_SHAPE_I, 1, 30);
+
+  _th_TetrominoWell_fill_row(wide, 3, 32);
+  TEST_ASSERT_FALSE(TetrominoWell_collision(wide, I, 0, 0));
+  TEST_ASSERT_TRUE(TetrominoWell_collision(wide, I, 2, 0));
+
+  TetrominoWell_lock(wide, I);
+  TEST_ASSERT_TRUE(TetrominoWell_occupied(wide, 1, 31));
+  TEST_ASSERT_TRUE(TetrominoWell_occupied(wide, 1, 32));
+  TEST_ASSERT_TRUE(TetrominoWell_occupied(wide, 1, 33));
+  TEST_ASSERT_FALSE(TetrominoWell_occupied(wide, 1, 34));
+
+  Tetromino_free(wide->pool, I);
+  TetrominoWell_free(wide);
+}
+
+void test_pool_release_and_reset(void) {
+  TetrominoPool *pool = TetrominoPool_init(2);
+
+  Tetromino *a = Tetromino_init(pool, TETROMINO_SHAPE_S, 0, 4);
+  Tetromino *b = Tetromino_init(pool, TETROMINO_SHAPE_Z, 0, 4);
+  TEST_ASSERT_NOT_EQUAL(a, b);
+  TEST_ASSERT_EQUAL_UINT(2, pool->used);
+
+  a->deg = 180;
+  Tetromino_free(pool, a);
+  Tetromino *c = Tetromino_init(pool, TETROMINO_SHAPE_T, 0, 4);
+  TEST_ASSERT_EQUAL_PTR(a, c);
+  TEST_ASSERT_EQUAL_UINT(0, c->deg);
+  TEST_ASSERT_EQUAL_INT(TETROMINO_SHAPE_T, c->shape);
+
+  TetrominoPool_reset(pool);
+  TEST_ASSERT_EQUAL_UINT(0, pool->used);
+  TEST_ASSERT_EQUAL_PTR(&pool->slots[0].t, Tetromino_init(pool, TETROMINO_SHAPE_O, 0, 4));
+
+  TetrominoPool_free(pool);
+}
+
+void test_collection_grows_past_initial_cap(void) {
+  TetrominoCollection *coll = TetrominoCollection_init(1);
+
+  for (size_t i = 0; i < 1000; i++) {
+    Tetromino *t = Tetromino_init(WELL->pool, i % TETROMINO_SHAPE_CNT, i, 5);
+    t->deg = (i % TETROMINO_ROTATION_CNT) * 90;
+    TetrominoCollection_push(coll, t);
+    Tetromino_free(WELL->pool, t);
+  }
+
+  TEST_ASSERT_EQUAL_UINT(1000, coll->cnt);
+  TEST_ASSERT_GREATER_OR_EQUAL(1000, coll->cap);
+
+  Tetromino t = TetrominoCollection_get(coll, 642);
+  TEST_ASSERT_EQUAL_INT(642 % TETROMINO_SHAPE_CNT, t.shape);
+  TEST_ASSERT_EQUAL_UINT(180, t.deg);
+  TEST_ASSERT_EQUAL_UINT(642, t.row0);
+
+  TetrominoCollection_free(coll);
+}
+
+void test_well_fill_counts_on_lock(void) {
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 1, 4);
+  _th_TetrominoWell_fill_row(WELL, WELL_ROWS - 2, 4);
+  TEST_ASSERT_EQUAL_UINT(WELL_COLS - 1, WELL->fill[WELL_ROWS - 1]);
+  TEST_ASSERT_EQUAL_UINT64(0, TetrominoWell_full_row_mask(WELL));
+
+  // Vertical I drops into the two-deep hole at column 4
+  Tetromino *I = Tetromino_init(WELL->pool, TETROMINO_SHAPE_I, WELL_ROWS - 3, 2);
+  I->deg = 90;
+  TetrominoWell_lock(WELL, I);
+
+  TEST_ASSERT_EQUAL_UINT(1, WELL->fill[WELL_ROWS - 4]);
+  TEST_ASSERT_EQUAL_UINT(1, WELL->fill[WELL_ROWS - 3]);
+  TEST_ASSERT_EQUAL_UINT(2, WELL->full_cnt);
+  TEST_ASSERT_EQUAL_UINT64(3ULL << (WELL_ROWS - 2), TetrominoWell_full_row_mask(WELL));
+
+  TEST_ASSERT_EQUAL_UINT(2, TetrominoWell_clear_full_rows(WELL));
+  TEST_ASSERT_EQUAL_UINT(1, WELL->fill[WELL_ROWS - 1]);
+  TEST_ASSERT_EQUAL_UINT(1, WELL->fill[WELL_ROWS - 2]);
+  TEST_ASSERT_EQUAL_UINT(0, WELL->fill[WELL_ROWS - 3]);
+  TEST_ASSERT_EQUAL_UINT64(0, TetrominoWell_full_row_mask(WELL));
+
+  Tetromino_free(WELL->pool, I);
+}
+
+void test_well_clear_resolves_locked_pieces(void) {
+  // L stands on the floor spanning the three bottom rows, and a second row is filled around it
+  Tetromino *L = Tetromino_init(WELL->pool, TETROMINO_SHAPE_L, WELL_ROWS - 3, 2);
+  L->deg = 90;
+  TetrominoWell_lock(WELL, L);
+  Tetromino_free(WELL->pool, L);
+
+  for (size_t col = 0; col < WELL_COLS; col++) {
+    if (col != 1) {
+      TetrominoWell_fill(WELL, WELL_ROWS - 2, col);
+    }
+  }
+
+  uint8_t mask = 0xFF;
+  MinoCoords before = TetrominoWell_locked_coords(WELL, 0, &mask);
+  size_t expected_before[MINO_COORDS_SIZE] = {19, 2, 17, 1, 18, 1, 19, 1};
+  TEST_ASSERT_EQUAL_UINT8(0, mask);
+  TEST_ASSERT_EQUAL_size_t_ARRAY(expected_before, before.coords, MINO_COORDS_SIZE);
+
+  TEST_ASSERT_EQUAL_UINT(1, TetrominoWell_clear_full_rows(WELL));
+
+  MinoCoords after = TetrominoWell_locked_coords(WELL, 0, &mask);
+  TEST_ASSERT_EQUAL_UINT8(0x4, mask);
+  TEST_ASSERT_EQUAL_UINT(19, after.coords[0]);
+  TEST_ASSERT_EQUAL_UINT(18, after.coords[2]);
+  TEST_ASSERT_EQUAL_UINT(19, after.coords[6]);
+
+  for (size_t row = 1; row < WELL_ROWS; row++) {
+    TEST_ASSERT_GREATER_THAN(WELL->row_id[row], WELL->row_id[row - 1]);
+  }
+}
+
+void test_well_clear_drops_cleared_pieces(void) {
+  // Two flat I fill most of the bottom row, a third lies on top of them
+  size_t const cols0[] = {0, 4, 0};
+  size_t const rows0[] = {WELL_ROWS - 1, WELL_ROWS - 1, WELL_ROWS - 2};
+  for (size_t i = 0; i < 3; i++) {
+    Tetromino *I = Tetromino_init(WELL->pool, TETROMINO_SHAPE_I, rows0[i], cols0[i]);
+    TetrominoWell_lock(WELL, I);
+    Tetromino_free(WELL->pool, I);
+  }
+  TetrominoWell_fill(WELL, WELL_ROWS - 1, 8);
+  TetrominoWell_fill(WELL, WELL_ROWS - 1, 9);
+  TEST_ASSERT_EQUAL_UINT(3, WELL->coll->cnt);
+
+  TEST_ASSERT_EQUAL_UINT(1, TetrominoWell_clear_full_rows(WELL));
+
+  // Only the top one is left, fallen onto the floor
+  TEST_ASSERT_EQUAL_UINT(1, WELL->coll->cnt);
+  uint8_t mask = 0xFF;
+  MinoCoords const c = TetrominoWell_locked_coords(WELL, 0, &mask);
+  TEST_ASSERT_EQUAL_UINT8(0, mask);
+  for (size_t m = 0; m < MINO_CNT; m++) {
+    TEST_ASSERT_EQUAL_UINT(WELL_ROWS - 1, c.coords[2 * m]);
+  }
+}
+
+void test_well_clear_tetris_on_tall_well(void) {
+  TetrominoWell *tall = TetrominoWell_init(40, WELL_COLS);
+
+  for (size_t row = 20; row < 40; row++) {
+    _th_TetrominoWell_fill_row(tall, row, row % 4 == 0 ? WELL_COLS : row % WELL_COLS);
+  }
+
+  TEST_ASSERT_EQUAL_UINT(5, TetrominoWell_clear_full_rows(tall));
+  TEST_ASSERT_EQUAL_UINT(0, tall->full_cnt);
+  for (size_t row = 0; row < 25; row++) {
+    TEST_ASSERT_EQUAL_UINT(0, tall->fill[row]);
+  }
+  for (size_t row = 25; row < 40; row++) {
+    TEST_ASSERT_EQUAL_UINT(WELL_COLS - 1, tall->fill[row]);
+    TEST_ASSERT_FALSE(TetrominoWell_row_full(tall, row));
+  }
+  TEST_ASSERT_FALSE(TetrominoWell_occupied(tall, 39, 39 % WELL_COLS));
+  TEST_ASSERT_FALSE(TetrominoWell_occupied(tall, 25, 21 % WELL_COLS));
+
+  TetrominoWell_free(tall);
+}
+
+void _th_check_kernels(TetrominoWell *const w) {
+  // Scatter locked minos over the bottom half, the same pattern for every kernel
+  srand(7);
+  for (size_t row = w->rows / 2; row < w->rows; row++) {
+    for (size_t col = 0; col < w->cols; col++) {
+      if (rand() % 3 == 0) {
+        TetrominoWell_fill(w, row, col);
+      }
+    }
+  }
+
+  static Tetromino candidates[TETROMINO_SHAPE_CNT * TETROMINO_ROTATION_CNT * 64];
+  static uint64_t legal[sizeof(candidates) / sizeof(candidates[0]) / 64 + 1];
+
+  for (ECollideKernel k = 0; k < COLLIDE_KERNEL_CNT; k++) {
+    if (!Collide_kernel_supported(k)) {
+      continue;
+    }
+    Collide_set_kernel(k);
+
+    for (ptrdiff_t row0 = -MINO_CNT; row0 <= (ptrdiff_t)w->rows; row0++) {
+      size_t cnt = 0;
+      for (ETetrominoShape shape = 0; shape < TETROMINO_SHAPE_CNT; shape++) {
+        for (size_t q = 0; q < TETROMINO_ROTATION_CNT; q++) {
+          ColMask const cols = TetrominoWell_legal_cols(w, shape, q, row0);
+
+          for (ptrdiff_t col0 = -COLLIDE_COL_BIAS; col0 < (ptrdiff_t)w->cols + MINO_CNT; col0++) {
+            Tetromino const t = {.row0 = (size_t)row0, .col0 = (size_t)col0, .deg = (uint32_t)q * 90, .shape = shape};
+            bool const expected = !TetrominoWell_collision(w, &t, 0, 0);
+            TEST_ASSERT_EQUAL_INT_MESSAGE(expected, (cols >> (col0 + COLLIDE_COL_BIAS)) & 1, "legal_cols");
+            candidates[cnt++] = t;
+          }
+        }
+      }
+
+      // Once whole, once with a tail that does not fill a vector
+      for (size_t n = cnt - 3; n <= cnt; n += 3) {
+        TetrominoWell_legal_batch(w, candidates, n, legal);
+        for (size_t i = 0; i < n; i++) {
+          bool const expected = !TetrominoWell_collision(w, &candidates[i], 0, 0);
+          TEST_ASSERT_EQUAL_INT_MESSAGE(expected, (legal[i / 64] >> (i % 64)) & 1, "legal_batch");
+        }
+      }
+    }
+  }
+}
+
+void test_collide_kernels_match_collision(void) { _th_check_kernels(WELL); }
+
+void test_collide_kernels_match_collision_wide(void) {
+  TetrominoWell *const w = TetrominoWell_init(WELL_ROWS, 40);
+  _th_check_kernels(w);
+  TetrominoWell_free(w);
+}
+
+uint64_t _th_hash(TetrominoWell const *const w) {
+  uint64_t hash = 0;
+  for (size_t row = 0; row < w->rows; row++) {
+    for (size_t col = 0; col < w->cols; col++) {
+      if (TetrominoWell_occupied(w, row, col)) {
+        hash ^= _Zobrist_rotl(_Zobrist_col(col), row);
+      }
+    }
+  }
+  return hash;
+}
+
+void test_well_hash_tracks_locks_and_clears(void) {
+  TEST_ASSERT_EQUAL_UINT64(0, WELL->hash);
+
+  // Drop random pieces to the bottom until rows clear, checking against a from scratch hash every time
+  srand(3);
+  for (size_t i = 0; i < 200; i++) {
+    Tetromino *t = Tetromino_init(WELL->pool, (ETetrominoShape)(rand() % TETROMINO_SHAPE_CNT), 0, 0);
+    Tetromino_rotate(t, (uint32_t)(rand() % 4) * 90);
+    Tetromino_translate(t, 0, (size_t)(rand() % WELL_COLS) - 2);
+    if (TetrominoWell_collision(WELL, t, 0, 0)) {
+      Tetromino_free(WELL->pool, t);
+      continue;
+    }
+    while (!TetrominoWell_collision(WELL, t, 1, 0)) {
+      Tetromino_translate(t, 1, 0);
+    }
+
+    uint64_t const expected = TetrominoWell_place_hash(WELL, t);
+    bool const clears = TetrominoWell_place_clears(WELL, t);
+    TetrominoWell_lock(WELL, t);
+    TEST_ASSERT_EQUAL_UINT64(expected, WELL->hash);
+    TEST_ASSERT_EQUAL_UINT64(_th_hash(WELL), WELL->hash);
+
+    TEST_ASSERT_EQUAL_INT(clears, TetrominoWell_clear_full_rows(WELL) > 0);
+    TEST_ASSERT_EQUAL_UINT64(_th_hash(WELL), WELL->hash);
+    Tetromino_free(WELL->pool, t);
+
+    if (WELL->fill[MINO_CNT] > 0) {
+      TetrominoWell_reset(WELL);
+      TEST_ASSERT_EQUAL_UINT64(0, WELL->hash);
+    }
+  }
+}
+
+void test_well_hash_copies_and_tells_positions_apart(void) {
+  TetrominoWell_fill(WELL, WELL_ROWS - 1, 0);
+  TetrominoWell *const copy = TetrominoWell_init(WELL_ROWS, WELL_COLS);
+  TetrominoWell_copy(copy, WELL);
+  TEST_ASSERT_EQUAL_UINT64(WELL->hash, copy->hash);
+
+  // Same cell one row up or one column over must hash differently
+  TetrominoWell_reset(copy);
+  TetrominoWell_fill(copy, WELL_ROWS - 2, 0);
+  TEST_ASSERT_NOT_EQUAL(WELL->hash, copy->hash);
+  TetrominoWell_reset(copy);
+  TetrominoWell_fill(copy, WELL_ROWS - 1, 1);
+  TEST_ASSERT_NOT_EQUAL(WELL->hash, copy->hash);
+  TetrominoWell_free(copy);
+
+  Tetromino *t = Tetromino_init(WELL->pool, TETROMINO_SHAPE_T, 0, 4);
+  uint64_t const spawn = Tetromino_hash(t);
+  Tetromino_translate(t, 0, 1);
+  TEST_ASSERT_NOT_EQUAL(spawn, Tetromino_hash(t));
+  Tetromino_translate(t, 0, -1);
+  Tetromino_rotate(t, 90);
+  TEST_ASSERT_NOT_EQUAL(spawn, Tetromino_hash(t));
+  Tetromino_rotate(t, 270);
+  TEST_ASSERT_EQUAL_UINT64(spawn, Tetromino_hash(t));
+  Tetromino_free(WELL->pool, t);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_rotation_table);
+  RUN_TEST(test_well_coords_rotated);
+  RUN_TEST(test_tetromino_hide_mino);
+  RUN_TEST(test_well_words_per_row);
+  RUN_TEST(test_well_collision_walls);
+  RUN_TEST(test_well_collision_locked);
+  RUN_TEST(test_well_clear_full_rows);
+  RUN_TEST(test_well_clear_full_rows_wide);
+  RUN_TEST(test_well_collision_wide_word_boundary);
+  RUN_TEST(test_well_fill_counts_on_lock);
+  RUN_TEST(test_well_clear_resolves_locked_pieces);
+  RUN_TEST(test_well_clear_drops_cleared_pieces);
+  RUN_TEST(test_well_clear_tetris_on_tall_well);
+  RUN_TEST(test_pool_release_and_reset);
+  RUN_TEST(test_collection_grows_past_initial_cap);
+  RUN_TEST(test_collide_kernels_match_collision);
+  RUN_TEST(test_collide_kernels_match_collision_wide);
+  RUN_TEST(test_well_hash_tracks_locks_and_clears);
+  RUN_TEST(test_well_hash_copies_and_tells_positions_apart);
+  return UNITY_END();
+}